@@ -12,9 +12,23 @@ const binding = {
       "product_dir": "<(module_root_dir)/src/native/.build",
       "sources": [ 
         "src/native/async.cpp",
+        "src/native/border.cpp",
+        "src/native/cache.cpp",
+        "src/native/decode.cpp",
+        "src/native/frame.cpp",
+        "src/native/glyph.cpp",
+        "src/native/inference.cpp",
         "src/native/logger.cpp",
         "src/native/main.cpp",
+        "src/native/ocr.cpp",
+        "src/native/pool.cpp",
+        "src/native/preprocess.cpp",
+        "src/native/scanner.cpp",
         "src/native/screen.cpp",
+        "src/native/stats.cpp",
+        "src/native/tiles.cpp",
+        "src/native/trace.cpp",
+        "src/native/tracker.cpp",
         "src/native/util.cpp",
         "src/native/wgc.cpp",
         "src/native/windows.cpp",
@@ -155,6 +169,21 @@ if (DEBUG) {
   };
 }
 
+// Optional inference engines, enabled with GRIMVAULT_ONNXRUNTIME=1 and / or
+// GRIMVAULT_OPENVINO=1 after installing the matching vcpkg feature.
+
+const ENGINES = {
+  GRIMVAULT_ONNXRUNTIME: [ "onnxruntime.lib" ],
+  GRIMVAULT_OPENVINO: [ DEBUG ? "openvinod.lib" : "openvino.lib" ]
+};
+
+for (const [ flag, libraries ] of Object.entries (ENGINES)) {
+  if (process.env [flag] === '1') {
+    binding.targets [0].defines.push (flag);
+    binding.targets [0].libraries.push (... libraries);
+  }
+}
+
 writeFileSync (
   BINDINGS,
   JSON.stringify (binding, null, 2)
@@ -1,8 +1,9 @@
 import electron from 'electron';
 import { logger } from './logger.js';
 import { settings } from './settings.js';
-import { getTooltip } from './native.js';
+import { getTooltip, recordTime, startScanner, updateScanner, stopScanner } from './native.js';
 import { api } from './api.js';
+import { now, span, traced } from './trace.js';
 
 const frontend = electron.ipcMain;
 
@@ -31,24 +32,139 @@ export function wire (overlay) {
     );
   });
 
-  frontend.on ('scan', async () => {
+  // Steps of a scan the overlay measured in the renderer process.
+  frontend.on ('trace', (event, data) => {
+    span (data.name, data.scan, data.start, data.end, {
+      category: 'renderer',
+      pid: overlay.webContents.getOSProcessId ()
+    });
+  });
+
+  // Scans are numbered so the second phase of an older scan never replaces
+  // the item of a newer one.
+  let latestScan = 0;
+
+  // The item the continuous scanner last reported, with its stats.
+  let watched = null;
+
+  if (settings.performance.continuous_scan) {
+    let latestChange = 0;
+
+    startScanner (async (tooltip) => {
+      let change = ++latestChange;
+
+      watched = null;
+
+      if (!tooltip) {
+        send ('watch:clear');
+        return;
+      }
+
+      let stats = await getItemStats (tooltip.text);
+
+      if (stats && change === latestChange) {
+        watched = {
+          ... tooltip,
+          ... stats
+        };
+
+        send ('watch:item', watched);
+      }
+    }, {
+      interval: settings.performance.scan_interval
+    });
+
+    electron.app.on ('will-quit', () => {
+      stopScanner ();
+    });
+  }
+
+  // The cursor is optional, when it is given the native module looks for the
+  // tooltip around it before scanning the whole screen. The overlay rects are
+  // the tooltips the overlay draws itself, which are never read. The trace
+  // holds the correlation ID the overlay gave the scan and when it sent it,
+  // every step of the scan is traced under that ID.
+  frontend.on ('scan', async (event, request) => {
+    let { cursor, overlay, trace } = request || {};
+    let received = now ();
+    let id = trace ? trace.id : 0;
+
+    if (trace) {
+      span ('ipc.scan', id, trace.sent, received, { category: 'ipc' });
+    }
+
+    // The scanner is already reading the screen, point it at the cursor and
+    // answer with what it found last.
+    if (settings.performance.continuous_scan) {
+      updateScanner (cursor, overlay || []);
+
+      send ('scan:start');
+      send (watched ? 'hover:item' : 'clear', watched && { ... watched, trace: id });
+      send ('scan:finish');
+
+      span ('scan', id, received, now ());
+      return;
+    }
+
+    let scan = ++latestScan;
+    let started = performance.now ();
+
     send ('scan:start');
 
     let tooltip;
 
     try {
-      tooltip = await getTooltip ();
+      tooltip = await traced ('getTooltip', id, () => getTooltip (cursor, overlay || [], id));
     } catch (e) {
       logger.error (`Error getting tooltip: ${e}`);
     }
 
+    // A newer scan makes this one stale, the native module stops it early
+    // and whatever it found is left to the newer scan. Its start is still
+    // paired with a finish.
+    if (scan !== latestScan) {
+      send ('scan:finish');
+      span ('scan.stale', id, received, now ());
+      return;
+    }
+
     if (tooltip) {
-      let stats = await getItemStats (tooltip.text);
+      // With two phase OCR only the header has been read yet, the rest of
+      // the tooltip follows once remaining resolves.
+      let { remaining, ... found } = tooltip;
+      let stats = await getItemStats (found.text, id);
+
+      // The scan may have gone stale while its price was looked up.
+      if (stats && scan === latestScan) {
+        recordTime ('scan.first_price', performance.now () - started);
 
-      if (stats) {
         send ('hover:item', {
-          ... tooltip,
-          ... stats
+          ... found,
+          ... stats,
+          trace: id
+        });
+      }
+
+      if (remaining) {
+        remaining.then (async (complete) => {
+          if (scan !== latestScan) {
+            return;
+          }
+
+          let stats = await getItemStats (complete.text, id);
+
+          if (stats && scan === latestScan) {
+            recordTime ('scan.full_price', performance.now () - started);
+
+            send ('hover:item', {
+              ... found,
+              ... complete,
+              ... stats,
+              trace: id
+            });
+          }
+        }).catch ((e) => {
+          logger.error (`Error reading the rest of the tooltip: ${e}`);
         });
       }
     } else {
@@ -56,16 +172,18 @@ export function wire (overlay) {
     }
 
     send ('scan:finish');
+    span ('scan', id, received, now ());
   });
 }
 
-async function getItemStats (tooltipText) {
+// The scan is the correlation ID the request is traced under.
+async function getItemStats (tooltipText, scan = 0) {
   try {
-    let response = await api.get ('/v1/internal/grimvault/analyze', {
+    let response = await traced ('analyze', scan, () => api.get ('/v1/internal/grimvault/analyze', {
       params: {
         tooltip: tooltipText
       }
-    });
+    }), { category: 'http' });
 
     if (!response) {
       return false;
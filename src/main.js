@@ -9,6 +9,7 @@ import { ROOT, SOURCE, isDebug } from './config.js';
 import { settings, settingsPath } from './settings.js';
 import { pin } from './pin.js';
 import { wire } from './frontend.js';
+import { saveTrace } from './trace.js';
 
 const { app, BrowserWindow } = electron;
 const { autoUpdater } = updater;
@@ -246,6 +247,11 @@ app.on ('ready', async () => {
     overlay.webContents.send ('manual:scan');
   });
 
+  globalShortcut.register (settings.hotkeys.save_trace, () => {
+    logger.info ('Saving trace');
+    saveTrace ();
+  });
+
   if (isDebug ()) {
     overlay.webContents.openDevTools ({
       mode: 'detach'
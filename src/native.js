@@ -2,6 +2,7 @@ import electron from 'electron';
 import { join } from 'node:path';
 import { RESOURCES, ROOT, SOURCE } from './config.js';
 import { logger } from './logger.js';
+import { settings } from './settings.js';
 import { createRequire } from 'module';
 
 const { app } = electron;
@@ -26,15 +27,33 @@ let native = createRequire (import.meta.url) (nativeModulePath);
 
 let tesseractModelPath;
 let onnxModelPath;
+let fontPath;
 
 if (app.isPackaged) {
   tesseractModelPath = join (ROOT, '..', 'models');
   onnxModelPath = join (ROOT, '..', 'models', 'tooltip.onnx');  
+  fontPath = join (ROOT, '..', 'fonts');
 } else {
   tesseractModelPath = join (ROOT, 'models', 'tesseract');
   onnxModelPath = join (ROOT, 'models', 'vision', 'runs', 'detect', 'train', 'weights', 'best.onnx');
+  fontPath = join (ROOT, 'assets', 'fonts');
 }
 
+// The fonts tooltips are drawn with, for the glyph reader
+const fonts = [ 'SaintKDG_Light.ttf', 'SaintKDG_Medium.ttf' ].map (font => join (fontPath, font));
+
+// The tooltip sections the enabled overlay components show. The header names
+// the item and is always read, prices also depend on its stats.
+const components = settings.general.components;
+const pricing = components.includes ('pricing');
+
+const sections = [
+  'header',
+  ... (components.includes ('primary') || pricing ? [ 'primary' ] : []),
+  ... (components.includes ('secondary') || pricing ? [ 'secondary' ] : []),
+  ... (components.includes ('details') ? [ 'details' ] : [])
+];
+
 let onMessageCallback = (level, message) => {
   logger [level] (`[Native] ${message}`);
 };
@@ -44,7 +63,21 @@ logger.info (`Initializing native screen module`);
 let success = native.initialize (
   tesseractModelPath,
   onnxModelPath,
-  onMessageCallback
+  onMessageCallback,
+  {
+    engine: settings.performance.inference_engine,
+    quantized: settings.performance.quantized_model,
+    inputSize: settings.performance.detector_input_size,
+    borderDetector: settings.performance.border_detector,
+    lineSegmentation: settings.performance.line_segmentation,
+    glyphReader: settings.performance.glyph_ocr,
+    readCacheSize: settings.performance.ocr_cache_size,
+    ocrXHeight: settings.performance.ocr_x_height,
+    sections,
+    twoPhaseRead: settings.performance.two_phase_ocr,
+    traceEvents: settings.performance.trace_events,
+    fonts
+  }
 );
 
 if (!success) {
@@ -54,12 +87,38 @@ if (!success) {
 
 let {
   getTooltip,
+  startScanner,
+  updateScanner,
+  stopScanner,
+  getScannerStats,
   getActiveWindow,
-  getGameWindow
+  getGameWindow,
+  getStats,
+  resetStats,
+  recordTime,
+  traceClock,
+  recordTrace,
+  dumpTrace,
+  benchmarkInference,
+  benchmarkDetector,
+  benchmarkOcr
 } = native;
 
 export {
   getTooltip,
+  startScanner,
+  updateScanner,
+  stopScanner,
+  getScannerStats,
   getActiveWindow,
-  getGameWindow
+  getGameWindow,
+  getStats,
+  resetStats,
+  recordTime,
+  traceClock,
+  recordTrace,
+  dumpTrace,
+  benchmarkInference,
+  benchmarkDetector,
+  benchmarkOcr
 };
\ No newline at end of file
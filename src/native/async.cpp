@@ -1,61 +1,250 @@
 #include "logger.h"
 #include "screen.h"
+#include "stats.h"
+#include "trace.h"
 #include "util.h"
+#include <atomic>
+#include <cstdint>
+#include <exception>
 #include <napi.h>
 #include <opencv2/core.hpp>
 #include <optional>
 #include <memory>
 #include <combaseapi.h>
 
-class TooltipWorker : public Napi::AsyncWorker 
+// Sets the text of a tooltip on a getTooltip result, all of it and by the
+// sections that were read.
+static void SetText (Napi::Object& Result, const TooltipText& Text)
+{
+   Napi::Env Env = Result.Env ();
+   Napi::Object Sections = Napi::Object::New (Env);
+   
+   for (int i = 0; i < SECTION_COUNT; ++i) {
+      if (Text.Read [i] && Screen::EnabledSections [i]) {
+         Sections.Set (SectionName ((Section) i), Napi::String::New (Env, Text.Sections [i]));
+      }
+   }
+   
+   Result.Set ("text", Napi::String::New (Env, JoinSections (Text.Sections)));
+   Result.Set ("sections", Sections);
+}
+
+// Like Napi::AsyncWorker, but Execute runs on the screen's work pool instead
+// of the libuv threadpool, which the main process also uses for file system
+// and DNS work. OnOK or OnError then run on the JS thread through a
+// ThreadSafeFunction and the worker deletes itself.
+class PoolWorker 
 {
    public:
 
-   TooltipWorker (const Napi::Env& Env, std::shared_ptr<Screen> ScreenPtr) : Napi::AsyncWorker (Env), 
+   virtual ~PoolWorker () = default;
+   
+   void Queue ()
+   {
+      Done = Napi::ThreadSafeFunction::New (
+         Environment,
+         Napi::Function::New (Environment, [] (const Napi::CallbackInfo&) {}),
+         "PoolWorker",
+         0,
+         1
+      );
+      
+      Workers.Submit ([ this ] () {
+         try {
+            Execute ();
+         } catch (const std::exception& E) {
+            SetError (E.what ());
+         } catch (...) {
+            SetError ("Unknown exception in a pool worker");
+         }
+         
+         // The worker may be deleted as soon as the call is queued.
+         Napi::ThreadSafeFunction Completion = Done;
+         
+         Completion.BlockingCall ([ this ] (Napi::Env, Napi::Function) {
+            Napi::HandleScope Scope (Environment);
+            
+            if (Error) {
+               OnError (Napi::Error::New (Environment, *Error));
+            } else {
+               OnOK ();
+            }
+            
+            delete this;
+         });
+         
+         Completion.Release ();
+      });
+   }
+   
+   protected:
+   
+   PoolWorker (const Napi::Env& Env, WorkPool& Workers) : Environment (Env),
+      Workers (Workers)
+   {
+   }
+   
+   Napi::Env Env () const
+   {
+      return Environment;
+   }
+   
+   virtual void Execute () = 0;
+   virtual void OnOK () = 0;
+   virtual void OnError (const Napi::Error& E) = 0;
+   
+   void SetError (const std::string& Message)
+   {
+      Error = Message;
+   }
+   
+   private:
+   
+   Napi::Env Environment;
+   WorkPool& Workers;
+   Napi::ThreadSafeFunction Done;
+   
+   std::optional<std::string> Error;
+};
+
+// Reads the sections of a tooltip that were left out of its first read and
+// resolves with its whole text.
+class SectionsWorker : public PoolWorker 
+{
+   public:
+
+   SectionsWorker (const Napi::Env& Env, std::shared_ptr<Screen> ScreenPtr, cv::Mat Crop, cv::Rect Tooltip, TooltipText Text, std::function<bool ()> Stale, uint64_t TraceId) : PoolWorker (Env, ScreenPtr->Pool ()), 
       Deferred (Napi::Promise::Deferred::New (Env)),
       ScreenObj (ScreenPtr),
-      Screenshot (nullptr)
+      Crop (std::move (Crop)),
+      Tooltip (Tooltip),
+      Text (std::move (Text)),
+      Stale (std::move (Stale)),
+      TraceId (TraceId)
+   {
+   }
+   
+   void Execute () override
+   {
+      Trace::Scope Traced (TraceId);
+      
+      // Nobody waits for the rest of a tooltip a newer scan replaced, it
+      // resolves with what was read of it.
+      if (Stale ()) {
+         Stats::count ("scan.stale.remaining");
+         return;
+      }
+      
+      try {
+         Stats::Timer Timer ("ocr.remaining");
+         
+         SectionSet Parts = Screen::EnabledSections;
+         
+         for (int i = 0; i < SECTION_COUNT; ++i) {
+            Parts [i] = Parts [i] && !Text.Read [i];
+         }
+         
+         Text.Merge (ScreenObj->Read (Crop, Parts));
+         ScreenObj->Complete (Crop, Tooltip, Text);
+      } catch (const std::exception& E) {
+         SetError (std::string ("Failed to read the remaining tooltip sections: ") + E.what ());
+      }
+   }
+   
+   void OnOK () override
+   {
+      Napi::Object Result = Napi::Object::New (Env ());
+      SetText (Result, Text);
+      
+      Deferred.Resolve (Result);
+   }
+   
+   void OnError (const Napi::Error& E) override
+   {
+      Deferred.Reject (E.Value ());
+   }
+   
+   Napi::Promise GetPromise () const
+   {
+      return Deferred.Promise ();
+   }
+   
+   private:
+
+   Napi::Promise::Deferred Deferred;
+   
+   std::shared_ptr<Screen> ScreenObj;
+   cv::Mat Crop;
+   cv::Rect Tooltip;
+   
+   TooltipText Text;
+   std::function<bool ()> Stale;
+   
+   uint64_t TraceId;
+};
+
+class TooltipWorker : public PoolWorker 
+{
+   public:
+
+   TooltipWorker (const Napi::Env& Env, std::shared_ptr<Screen> ScreenPtr, std::optional<Screen::Cursor> Position, std::vector<cv::Rect> Exclusions, uint64_t TraceId) : PoolWorker (Env, ScreenPtr->Pool ()), 
+      Deferred (Napi::Promise::Deferred::New (Env)),
+      ScreenObj (ScreenPtr),
+      Position (Position),
+      Exclusions (std::move (Exclusions)),
+      Generation (++LatestGeneration),
+      TraceId (TraceId)
    {
    }
    
    ~TooltipWorker () 
    {
-      // Screenshot managed by unique_ptr
+      // Screenshot is a shared reference into the frame pool
    }
    
+   // Runs on a work pool thread, which joined a COM apartment when it
+   // started.
    void Execute () override
    {
-      // Initialize COM for this thread to safely access COM objects
-      HRESULT comResult = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
-      bool comInitialized = SUCCEEDED(comResult);
-      
-      // Ensure COM cleanup on exit
-      auto comCleanup = std::unique_ptr<void, std::function<void(void*)>>(
-         &comResult,
-         [comInitialized](void*) {
-            if (comInitialized) {
-               CoUninitialize();
-            }
-         }
-      );
+      // The stages of this scan are traced under the ID JS passed in.
+      Trace::Scope Traced (TraceId);
+      Stats::Timer Timer ("scan.total");
       
       try {
          Tooltip = std::nullopt;
+         
+         // Scans wait for a free pool thread, by the time this one got it
+         // the mouse may have moved on already.
+         if (IsStale ("scan.stale.queued")) {
+            return;
+         }
 
          // Logger::log (
          //     Logger::Level::E_DEBUG,
          //     "Attempting screen capture"
          // );
          
-         std::optional<cv::Mat> MaybeScreenshot = ScreenObj->Capture ();
+         // Holding the reference keeps the pooled frame alive without copying it
+         Screenshot = ScreenObj->Capture ();
          
-         if (!MaybeScreenshot) {
+         if (!Screenshot) {
             Error = "Failed to capture the screen";
             return;
          }
          
-         // Store screenshot in heap memory using smart pointer
-         Screenshot = std::make_unique<cv::Mat> (*MaybeScreenshot);
+         if (IsStale ("scan.stale.capture")) {
+            return;
+         }
+         
+         // Most scans look at the same tooltip as the previous one, when the
+         // screen under it did not change reuse what was read last time.
+         if (std::optional<Screen::Reading> Cached = ScreenObj->Recall (Screenshot->Image)) {
+            Tooltip = Cached->Tooltip;
+            Text = Cached->Text;
+            
+            KeepRemaining ();
+            return;
+         }
          
          std::vector<cv::Rect> Tooltips;
          
@@ -65,7 +254,7 @@ class TooltipWorker : public Napi::AsyncWorker
             //     "Attempting to find tooltip in screenshot"
             // );
             
-            std::optional<std::vector<cv::Rect>> MaybeTooltips = ScreenObj->FindTooltips (*Screenshot);
+            std::optional<std::vector<cv::Rect>> MaybeTooltips = ScreenObj->Locate (Screenshot->Image, Position, Exclusions);
             
             if (!MaybeTooltips) {
                // Logger::log (
@@ -82,6 +271,10 @@ class TooltipWorker : public Napi::AsyncWorker
             return;
          }
          
+         if (IsStale ("scan.stale.detect")) {
+            return;
+         }
+         
          try {
             // Logger::log (
             //     Logger::Level::E_DEBUG,
@@ -90,27 +283,37 @@ class TooltipWorker : public Napi::AsyncWorker
             
             // Text = ScreenObj->Read (Screenshot (*Tooltip));
             
-            // Until we retrain the tooltip model to not recognize the GrimVault tooltip, 
-            // we have to check the text to see if it is a valid tooltip.
+            // With two phases only the header is read before resolving, it
+            // names the item and is enough to look up its price.
+            SectionSet Parts = Screen::EnabledSections;
             
-            for (const auto& Candidate : Tooltips) {
-               Text = ScreenObj->Read ((*Screenshot) (Candidate));
-               
-               // Logger::log (
-               //     Logger::Level::E_DEBUG,
-               //     "Found tooltip text: " + Text
-               // );
-               
-               if (Text.find ("Item Statistics") == std::string::npos) {
-                  Tooltip = Candidate;
-                  break;
-               }
+            if (Screen::UseTwoPhaseRead) {
+               Parts.fill (false);
+               Parts [(int) Section::Header] = true;
+            }
+            
+            // Candidates are not read once the scan is stale and the one being
+            // read is abandoned.
+            auto Stale = [ this ] () {
+               return LatestGeneration.load () != Generation;
+            };
+            
+            std::optional<Screen::Reading> Best = ScreenObj->ReadBest (Screenshot->Image, Tooltips, Parts, Stale);
+            
+            if (!Best && Stale ()) {
+               return;
             }
             
-            if (!Tooltip) {
-               Error = std::string ("All identified tooltips belong to GrimVault");
+            if (!Best) {
+               Error = std::string ("None of the identified tooltips could be read");
                return;
             }
+            
+            Tooltip = Best->Tooltip;
+            Text = Best->Text;
+            
+            ScreenObj->Remember (Screenshot->Image, { *Tooltip, Text });
+            KeepRemaining ();
          } catch (const std::runtime_error& E) {
             Error = std::string ("Tesseract error while reading text: ") + E.what ();
             return;
@@ -165,6 +368,7 @@ class TooltipWorker : public Napi::AsyncWorker
       Napi::Env EnvLocal = Env ();
       
       if (!Error.empty ()) {
+         Stats::count ("scan.failures");
          Deferred.Reject (Napi::String::New (EnvLocal, Error));
          return;
       }
@@ -175,7 +379,24 @@ class TooltipWorker : public Napi::AsyncWorker
       
       Napi::Object Result = Napi::Object::New (EnvLocal);
       
-      Result.Set ("text", Napi::String::New (EnvLocal, Text));
+      SetText (Result, Text);
+      
+      // The sections left for the second phase resolve a follow-up promise
+      // with the whole text.
+      Result.Set ("complete", Napi::Boolean::New (EnvLocal, Remaining.empty ()));
+      
+      if (!Remaining.empty ()) {
+         uint64_t Scan = Generation;
+         
+         auto Stale = [ Scan ] () {
+            return LatestGeneration.load () != Scan;
+         };
+         
+         auto* Worker = new SectionsWorker (EnvLocal, ScreenObj, std::move (Remaining), *Tooltip, Text, Stale, TraceId);
+         Worker->Queue ();
+         
+         Result.Set ("remaining", Worker->GetPromise ());
+      }
       
       Result.Set ("x", Napi::Number::New (EnvLocal, Tooltip->x));
       Result.Set ("y", Napi::Number::New (EnvLocal, Tooltip->y));
@@ -192,6 +413,8 @@ class TooltipWorker : public Napi::AsyncWorker
          "Error in TooltipWorker: " + std::string (E.Message ())    
       );
       
+      Stats::count ("scan.failures");
+      
       Deferred.Reject (E.Value ());
    }
    
@@ -202,13 +425,232 @@ class TooltipWorker : public Napi::AsyncWorker
    
    private:
 
+   // Generation of the latest scan. Every getTooltip call starts a new one
+   // and makes the scans before it stale, they stop at their next check.
+   static inline std::atomic<uint64_t> LatestGeneration = 0;
+
    std::shared_ptr<Screen> ScreenObj;
+   std::optional<Screen::Cursor> Position;
+   std::vector<cv::Rect> Exclusions;
+   
+   uint64_t Generation;
+   
+   // Correlation ID of the scan in the trace, zero without one
+   uint64_t TraceId;
    
    Napi::Promise::Deferred Deferred;
    
    std::optional<cv::Rect> Tooltip;
-   std::unique_ptr<cv::Mat> Screenshot;
+   FrameRef Screenshot;
    
    std::string Error;
-   std::string Text;
+   TooltipText Text;
+   
+   // Copy of the tooltip while sections of it are still to be read, the
+   // pooled frame is released as soon as the first phase is done.
+   cv::Mat Remaining;
+   
+   // Whether a newer scan was started, counted as Counter when it was.
+   bool IsStale (const char* Counter) const
+   {
+      if (LatestGeneration.load () == Generation) {
+         return false;
+      }
+      
+      Stats::count (Counter);
+      return true;
+   }
+   
+   void KeepRemaining ()
+   {
+      if (!Text.Covers (Screen::EnabledSections)) {
+         Remaining = Screenshot->Image (*Tooltip).clone ();
+      }
+   }
+};
+
+class InferenceBenchmarkWorker : public Napi::AsyncWorker 
+{
+   public:
+
+   InferenceBenchmarkWorker (const Napi::Env& Env, std::shared_ptr<Screen> ScreenPtr, int Runs) : Napi::AsyncWorker (Env), 
+      Deferred (Napi::Promise::Deferred::New (Env)),
+      ScreenObj (ScreenPtr),
+      Runs (Runs)
+   {
+   }
+   
+   void Execute () override
+   {
+      try {
+         Results = ScreenObj->BenchmarkInferenceEngines (Runs);
+      } catch (const std::exception& E) {
+         SetError (std::string ("Failed to benchmark inference engines: ") + E.what ());
+      }
+   }
+   
+   void OnOK () override
+   {
+      Napi::Env EnvLocal = Env ();
+      
+      Napi::Object Result = Napi::Object::New (EnvLocal);
+      
+      for (const auto& [ Name, Benchmark ] : Results) {
+         Napi::Object Latency = Napi::Object::New (EnvLocal);
+         
+         Latency.Set ("p50", Napi::Number::New (EnvLocal, Benchmark.Median));
+         Latency.Set ("p99", Napi::Number::New (EnvLocal, Benchmark.P99));
+         
+         Result.Set (Name, Latency);
+      }
+      
+      Deferred.Resolve (Result);
+   }
+   
+   void OnError (const Napi::Error& E) override
+   {
+      Deferred.Reject (E.Value ());
+   }
+   
+   Napi::Promise GetPromise () const
+   {
+      return Deferred.Promise ();
+   }
+   
+   private:
+
+   Napi::Promise::Deferred Deferred;
+   
+   std::shared_ptr<Screen> ScreenObj;
+   int Runs;
+   
+   std::vector<std::pair<std::string, InferenceBenchmark>> Results;
+};
+
+class DetectorBenchmarkWorker : public Napi::AsyncWorker 
+{
+   public:
+
+   DetectorBenchmarkWorker (const Napi::Env& Env, std::shared_ptr<Screen> ScreenPtr, int Runs, std::string Directory) : Napi::AsyncWorker (Env), 
+      Deferred (Napi::Promise::Deferred::New (Env)),
+      ScreenObj (ScreenPtr),
+      Runs (Runs),
+      Directory (std::move (Directory))
+   {
+   }
+   
+   void Execute () override
+   {
+      try {
+         Results = ScreenObj->BenchmarkDetector (Runs, Directory);
+      } catch (const std::exception& E) {
+         SetError (std::string ("Failed to benchmark the detector stages: ") + E.what ());
+      }
+   }
+   
+   void OnOK () override
+   {
+      Napi::Env EnvLocal = Env ();
+      
+      Napi::Object Result = Napi::Object::New (EnvLocal);
+      
+      for (const auto& [ Name, Benchmark ] : Results) {
+         Napi::Object Stage = Napi::Object::New (EnvLocal);
+         
+         Stage.Set ("difference", Napi::Number::New (EnvLocal, Benchmark.Difference));
+         Stage.Set ("p50", Napi::Number::New (EnvLocal, Benchmark.Median));
+         Stage.Set ("p99", Napi::Number::New (EnvLocal, Benchmark.P99));
+         
+         if (Benchmark.Recall) {
+            Stage.Set ("recall", Napi::Number::New (EnvLocal, *Benchmark.Recall));
+         }
+         
+         if (Benchmark.Precision) {
+            Stage.Set ("precision", Napi::Number::New (EnvLocal, *Benchmark.Precision));
+         }
+         
+         Result.Set (Name, Stage);
+      }
+      
+      Deferred.Resolve (Result);
+   }
+   
+   void OnError (const Napi::Error& E) override
+   {
+      Deferred.Reject (E.Value ());
+   }
+   
+   Napi::Promise GetPromise () const
+   {
+      return Deferred.Promise ();
+   }
+   
+   private:
+
+   Napi::Promise::Deferred Deferred;
+   
+   std::shared_ptr<Screen> ScreenObj;
+   int Runs;
+   std::string Directory;
+   
+   std::vector<std::pair<std::string, StageBenchmark>> Results;
+};
+
+class ReadBenchmarkWorker : public Napi::AsyncWorker 
+{
+   public:
+
+   ReadBenchmarkWorker (const Napi::Env& Env, std::shared_ptr<Screen> ScreenPtr, std::string Directory) : Napi::AsyncWorker (Env), 
+      Deferred (Napi::Promise::Deferred::New (Env)),
+      ScreenObj (ScreenPtr),
+      Directory (std::move (Directory))
+   {
+   }
+   
+   void Execute () override
+   {
+      try {
+         Results = ScreenObj->BenchmarkReadModes (Directory);
+      } catch (const std::exception& E) {
+         SetError (std::string ("Failed to benchmark OCR: ") + E.what ());
+      }
+   }
+   
+   void OnOK () override
+   {
+      Napi::Env EnvLocal = Env ();
+      
+      Napi::Object Result = Napi::Object::New (EnvLocal);
+      
+      for (const auto& [ Name, Benchmark ] : Results) {
+         Napi::Object Mode = Napi::Object::New (EnvLocal);
+         
+         Mode.Set ("cer", Napi::Number::New (EnvLocal, Benchmark.ErrorRate));
+         Mode.Set ("p50", Napi::Number::New (EnvLocal, Benchmark.Median));
+         Mode.Set ("p99", Napi::Number::New (EnvLocal, Benchmark.P99));
+         
+         Result.Set (Name, Mode);
+      }
+      
+      Deferred.Resolve (Result);
+   }
+   
+   void OnError (const Napi::Error& E) override
+   {
+      Deferred.Reject (E.Value ());
+   }
+   
+   Napi::Promise GetPromise () const
+   {
+      return Deferred.Promise ();
+   }
+   
+   private:
+
+   Napi::Promise::Deferred Deferred;
+   
+   std::shared_ptr<Screen> ScreenObj;
+   std::string Directory;
+   
+   std::vector<std::pair<std::string, ReadBenchmark>> Results;
 };
\ No newline at end of file
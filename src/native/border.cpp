@@ -0,0 +1,315 @@
+#include "border.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+
+void BorderDetector::FindEdges (const cv::Mat& Gray, cv::Mat& Horizontal, cv::Mat& Vertical)
+{
+   Horizontal.create (Gray.size (), CV_8U);
+   Vertical.create (Gray.size (), CV_8U);
+
+   Horizontal.setTo (0);
+   Vertical.setTo (0);
+
+   int Width = Gray.cols;
+
+   // Central differences, a horizontal edge is a step between the rows above
+   // and below and a vertical edge one between the pixels left and right.
+   for (int y = 1; y + 1 < Gray.rows; ++y) {
+      const uint8_t* Above = Gray.ptr<uint8_t> (y - 1);
+      const uint8_t* Row = Gray.ptr<uint8_t> (y);
+      const uint8_t* Below = Gray.ptr<uint8_t> (y + 1);
+
+      uint8_t* HorizontalRow = Horizontal.ptr<uint8_t> (y);
+      uint8_t* VerticalRow = Vertical.ptr<uint8_t> (y);
+
+      int x = 1;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+      const int Lanes = cv::VTraits<cv::v_uint8>::vlanes ();
+
+      cv::v_uint8 Threshold = cv::vx_setall_u8 (EDGE_THRESHOLD);
+
+      for (; x + Lanes < Width; x += Lanes) {
+         cv::v_uint8 Across = cv::v_absdiff (cv::vx_load (Above + x), cv::vx_load (Below + x));
+         cv::v_uint8 Along = cv::v_absdiff (cv::vx_load (Row + x - 1), cv::vx_load (Row + x + 1));
+
+         cv::v_store (HorizontalRow + x, cv::v_gt (Across, Threshold));
+         cv::v_store (VerticalRow + x, cv::v_gt (Along, Threshold));
+      }
+#endif
+
+      for (; x + 1 < Width; ++x) {
+         HorizontalRow [x] = std::abs (Above [x] - Below [x]) > EDGE_THRESHOLD ? 255 : 0;
+         VerticalRow [x] = std::abs (Row [x - 1] - Row [x + 1]) > EDGE_THRESHOLD ? 255 : 0;
+      }
+   }
+}
+
+bool BorderDetector::FindSegments (const cv::Mat& Edges, int MinimumLength, std::vector<Segment>& Segments)
+{
+   Segments.clear ();
+
+   for (int y = 0; y < Edges.rows; ++y) {
+      const uint8_t* Row = Edges.ptr<uint8_t> (y);
+
+      int Start = -1;
+      int Last = -1;
+
+      auto Close = [ & ] () {
+         if (Start >= 0 && Last + 1 - Start >= MinimumLength) {
+            Segments.push_back ({ y, Start, Last + 1 });
+         }
+
+         Start = -1;
+      };
+
+      for (int x = 0; x < Edges.cols; ++x) {
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+         // Most of a row is not edge, skip it a vector at a time while not
+         // inside a segment.
+         if (Start < 0) {
+            const int Lanes = cv::VTraits<cv::v_uint8>::vlanes ();
+
+            while (x + Lanes <= Edges.cols && !cv::v_check_any (cv::vx_load (Row + x))) {
+               x += Lanes;
+            }
+
+            if (x >= Edges.cols) {
+               break;
+            }
+         }
+#endif
+
+         if (Row [x]) {
+            if (Start < 0) {
+               Start = x;
+            }
+
+            Last = x;
+         } else if (Start >= 0 && x - Last > MAXIMUM_GAP) {
+            Close ();
+         }
+      }
+
+      Close ();
+
+      if (Segments.size () > MAXIMUM_SEGMENTS) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+float BorderDetector::Coverage (const cv::Mat& Edges, int Line, int Start, int End)
+{
+   Start = std::max (Start, 0);
+   End = std::min (End, Edges.cols);
+
+   if (End <= Start) {
+      return 0;
+   }
+
+   int Best = 0;
+
+   // Borders are a few pixels thick and their edges do not line up exactly
+   // with the corner, take the best line near the expected one.
+   for (int y = std::max (Line - CORNER_TOLERANCE, 0); y <= std::min (Line + CORNER_TOLERANCE, Edges.rows - 1); ++y) {
+      Best = std::max (Best, cv::countNonZero (Edges.row (y).colRange (Start, End)));
+   }
+
+   return (float) Best / (End - Start);
+}
+
+float BorderDetector::Verify (const cv::Mat& Image, const cv::Rect& Box, int Reach)
+{
+   int Channels = Image.channels ();
+
+   auto Gray = [ & ] (int x, int y) {
+      const uint8_t* Pixel = Image.ptr<uint8_t> (y) + x * Channels;
+      return Channels >= 3 ? (Pixel [0] + Pixel [1] + Pixel [2]) / 3 : (int) Pixel [0];
+   };
+
+   auto Spread = [ & ] (int x, int y) {
+      const uint8_t* Pixel = Image.ptr<uint8_t> (y) + x * Channels;
+      return Channels >= 3 ? std::max ({ Pixel [0], Pixel [1], Pixel [2] }) - std::min ({ Pixel [0], Pixel [1], Pixel [2] }) : 0;
+   };
+
+   cv::Rect Bounds (0, 0, Image.cols, Image.rows);
+
+   // Whether the line crosses the side within Reach of where the edges put
+   // it, with the inside of the frame in the Inward direction from it. Along
+   // and across are x and y on the top and bottom sides, y and x on the left
+   // and right ones.
+   auto Matches = [ & ] (bool IsHorizontal, int Along, int Line, int Inward) {
+      for (int Offset = -Reach; Offset <= Reach; ++Offset) {
+         int Across = Line + Offset;
+
+         cv::Point At = IsHorizontal ? cv::Point (Along, Across) : cv::Point (Across, Along);
+         cv::Point Deepest = IsHorizontal ? cv::Point (Along, Across + Inward * INTERIOR_END) : cv::Point (Across + Inward * INTERIOR_END, Along);
+
+         if (!Bounds.contains (At) || !Bounds.contains (Deepest)) {
+            continue;
+         }
+
+         int Level = Gray (At.x, At.y);
+
+         if (Level < LINE_DARKEST || Level > LINE_BRIGHTEST || Spread (At.x, At.y) > LINE_SPREAD) {
+            continue;
+         }
+
+         int Interior = 0;
+
+         for (int Depth = INTERIOR_START; Depth <= INTERIOR_END; ++Depth) {
+            Interior += IsHorizontal ? Gray (Along, Across + Inward * Depth) : Gray (Across + Inward * Depth, Along);
+         }
+
+         if (Interior <= INTERIOR_BRIGHTEST * (INTERIOR_END - INTERIOR_START + 1)) {
+            return true;
+         }
+      }
+
+      return false;
+   };
+
+   struct Side
+   {
+      bool IsHorizontal;
+      int Line;
+      int Inward;
+      int Start;
+      int Length;
+   };
+
+   const Side SIDES [] = {
+      { true, Box.y, 1, Box.x, Box.width },
+      { true, Box.y + Box.height - 1, -1, Box.x, Box.width },
+      { false, Box.x, 1, Box.y, Box.height },
+      { false, Box.x + Box.width - 1, -1, Box.y, Box.height }
+   };
+
+   int Total = 0;
+
+   for (const Side& Each : SIDES) {
+      int Matched = 0;
+
+      // Evenly spaced and clear of the corners, which carry studs instead
+      // of the line.
+      for (int i = 1; i <= SIDE_SAMPLES; ++i) {
+         int Along = Each.Start + Each.Length * i / (SIDE_SAMPLES + 1);
+
+         if (Matches (Each.IsHorizontal, Along, Each.Line, Each.Inward)) {
+            Matched += 1;
+         }
+      }
+
+      if (Matched < MINIMUM_MATCH * SIDE_SAMPLES) {
+         return -1;
+      }
+
+      Total += Matched;
+   }
+
+   return (float) Total / (4 * SIDE_SAMPLES);
+}
+
+const std::vector<BorderDetector::Frame>& BorderDetector::Detect (const cv::Mat& Image)
+{
+   Found.clear ();
+
+   int Factor = std::max (1, (Image.rows + WORKING_HEIGHT - 1) / WORKING_HEIGHT);
+
+   const cv::Mat* Source = &Image;
+
+   if (Factor > 1) {
+      cv::resize (Image, Small, cv::Size (Image.cols / Factor, Image.rows / Factor), 0, 0, cv::INTER_AREA);
+      Source = &Small;
+   }
+
+   switch (Source->channels ()) {
+      case 4:
+         cv::cvtColor (*Source, Gray, cv::COLOR_BGRA2GRAY);
+         break;
+      case 3:
+         cv::cvtColor (*Source, Gray, cv::COLOR_BGR2GRAY);
+         break;
+      default:
+         Gray = *Source;
+         break;
+   }
+
+   if (Gray.rows < 3 || Gray.cols < 3) {
+      return Found;
+   }
+
+   FindEdges (Gray, Horizontal, Vertical);
+   cv::transpose (Vertical, VerticalTransposed);
+
+   int MinimumLength = MINIMUM_SIDE / Factor;
+
+   if (
+      !FindSegments (Horizontal, MinimumLength, Rows) || 
+      !FindSegments (VerticalTransposed, MinimumLength, Columns)
+   ) {
+      return Found;
+   }
+
+   Candidates.clear ();
+
+   // Rows are horizontal edges at Line = y, columns vertical ones at Line = x.
+   for (const Segment& Top : Rows) {
+      for (const Segment& Left : Columns) {
+         if (
+            std::abs (Left.Line - Top.Start) > CORNER_TOLERANCE || 
+            std::abs (Left.Start - Top.Line) > CORNER_TOLERANCE
+         ) {
+            continue;
+         }
+
+         int X = std::min (Top.Start, Left.Line);
+         int Y = std::min (Top.Line, Left.Start);
+
+         int Right = Top.End - 1;
+         int Bottom = Left.End - 1;
+
+         if (
+            Coverage (VerticalTransposed, Right, Y, Bottom + 1) < MINIMUM_COVERAGE || 
+            Coverage (Horizontal, Bottom, X, Right + 1) < MINIMUM_COVERAGE
+         ) {
+            continue;
+         }
+
+         cv::Rect Box (X * Factor, Y * Factor, (Right + 1 - X) * Factor, (Bottom + 1 - Y) * Factor);
+
+         // The working pixels the edges may be off by, at full resolution.
+         float Match = Verify (Image, Box, (CORNER_TOLERANCE + 1) * Factor);
+
+         if (Match >= 0) {
+            Candidates.push_back ({ Box, Match });
+         }
+      }
+   }
+
+   std::sort (Candidates.begin (), Candidates.end (), [] (const Frame& A, const Frame& B) {
+      return A.Box.area () > B.Box.area ();
+   });
+
+   // Both sides of a border and the decorations inside a tooltip produce
+   // smaller rectangles within the frame. Only frames that passed the art
+   // check get to hide others, a panel around a tooltip does not.
+   for (const Frame& Candidate : Candidates) {
+      bool Inside = std::any_of (Found.begin (), Found.end (), [ & ] (const Frame& Larger) {
+         return (Candidate.Box & Larger.Box).area () * 2 >= Candidate.Box.area ();
+      });
+
+      if (!Inside) {
+         Found.push_back (Candidate);
+      }
+   }
+
+   return Found;
+}
\ No newline at end of file
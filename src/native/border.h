@@ -0,0 +1,107 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+#include <vector>
+
+// Finds tooltip frames without the detection model. The frame is reduced to
+// grayscale at a working resolution and its long horizontal and vertical
+// edges are collected. Every top and left edge that meet in a corner become a
+// candidate once a matching right and bottom edge close the rectangle.
+//
+// Inventory grids, stash panels and dialogs have long straight edges too, so
+// a candidate is only kept when its sides look like the frame art at full
+// resolution: the neutral gray line of Background_TooltipBorder.png with the
+// near black Background_TooltipTexture.png right inside it.
+class BorderDetector
+{
+   public:
+
+   struct Frame
+   {
+      cv::Rect Box;
+
+      // Share of the samples along the sides that matched the art
+      float Match;
+   };
+
+   // Frames are scaled down by an integer factor to at most this height.
+   static constexpr int WORKING_HEIGHT = 540;
+
+   // Gray level step across a border that counts as an edge.
+   static constexpr int EDGE_THRESHOLD = 32;
+
+   // Shortest tooltip side in screenshot pixels.
+   static constexpr int MINIMUM_SIDE = 160;
+
+   // Gaps up to this long do not end an edge, in working pixels.
+   static constexpr int MAXIMUM_GAP = 2;
+
+   // How far edges meeting in a corner may miss each other, in working pixels.
+   static constexpr int CORNER_TOLERANCE = 4;
+
+   // Share of the right and bottom sides that has to be edge.
+   static constexpr float MINIMUM_COVERAGE = 0.85f;
+
+   // Busy frames have too many long edges to pair up cheaply, the detector
+   // gives up on them.
+   static constexpr int MAXIMUM_SEGMENTS = 256;
+
+   // Gray level range and largest channel difference of the frame line. The
+   // art's line is 54 to 67 with equal channels, its corner studs are left
+   // out of the samples.
+   static constexpr int LINE_DARKEST = 40;
+   static constexpr int LINE_BRIGHTEST = 110;
+   static constexpr int LINE_SPREAD = 16;
+
+   // Mean gray level the inside of the frame stays below, from 3 to 12
+   // pixels past the line. The art is black there, ramping up to the
+   // texture which never gets above 19.
+   static constexpr int INTERIOR_START = 3;
+   static constexpr int INTERIOR_END = 12;
+   static constexpr int INTERIOR_BRIGHTEST = 32;
+
+   // Samples taken along each side, and the share of them that has to match
+   // on every side.
+   static constexpr int SIDE_SAMPLES = 16;
+   static constexpr float MINIMUM_MATCH = 0.75f;
+
+   // Returns the frames found in Image in its own coordinates, largest
+   // first. Frames mostly inside a larger one are dropped. The result is
+   // reused by the next call.
+   const std::vector<Frame>& Detect (const cv::Mat& Image);
+
+   private:
+
+   // A run of edge pixels on one row of an edge map, End is exclusive.
+   struct Segment
+   {
+      int Line;
+      int Start;
+      int End;
+   };
+
+   cv::Mat Small;
+   cv::Mat Gray;
+
+   // Horizontal edges, and vertical edges transposed so that both are
+   // scanned along rows.
+   cv::Mat Horizontal;
+   cv::Mat Vertical;
+   cv::Mat VerticalTransposed;
+
+   std::vector<Segment> Rows;
+   std::vector<Segment> Columns;
+
+   std::vector<Frame> Candidates;
+   std::vector<Frame> Found;
+
+   static void FindEdges (const cv::Mat& Gray, cv::Mat& Horizontal, cv::Mat& Vertical);
+   static bool FindSegments (const cv::Mat& Edges, int MinimumLength, std::vector<Segment>& Segments);
+   static float Coverage (const cv::Mat& Edges, int Line, int Start, int End);
+
+   // Share of the samples along the sides of Box that match the art, or a
+   // negative value when a side has too few. Reach is how far across a side
+   // its line is looked for.
+   static float Verify (const cv::Mat& Image, const cv::Rect& Box, int Reach);
+};
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "cache.h"
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <climits>
+#include <cstdlib>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+const int INK_LEVEL = 128;
+
+// The hash is taken from the lowest 8x8 DCT frequencies of a 32x32 copy.
+const int HASH_IMAGE_SIZE = 32;
+const int HASH_FREQUENCIES = 8;
+
+inline int PopCount (uint64_t Value)
+{
+   return (int) std::bitset<64> (Value).count ();
+}
+
+inline int WordsPerRow (int Width)
+{
+   return (Width + 63) / 64;
+}
+
+// 64 pixels of a packed row starting at any pixel.
+inline uint64_t BitsAt (const uint64_t* Row, int Words, int Offset)
+{
+   int Word = Offset >> 6;
+   int Bit = Offset & 63;
+
+   uint64_t Low = Word < Words ? Row [Word] >> Bit : 0;
+   uint64_t High = Bit && Word + 1 < Words ? Row [Word + 1] << (64 - Bit) : 0;
+
+   return Low | High;
+}
+
+// Counts differing pixels where B, shifted by Dx and Dy, overlaps A. Stops
+// counting once Limit is exceeded.
+int Mismatches (const TextCache::Key& A, const TextCache::Key& B, int Dx, int Dy, int Limit)
+{
+   int AX = std::max (0, -Dx);
+   int AY = std::max (0, -Dy);
+
+   int Width = std::min (A.Size.width - AX, B.Size.width - AX - Dx);
+   int Height = std::min (A.Size.height - AY, B.Size.height - AY - Dy);
+
+   if (Width <= 0 || Height <= 0) {
+      return INT_MAX;
+   }
+
+   int AWords = WordsPerRow (A.Size.width);
+   int BWords = WordsPerRow (B.Size.width);
+
+   int Count = 0;
+
+   for (int y = 0; y < Height; ++y) {
+      const uint64_t* ARow = A.Bits.data () + (size_t) (AY + y) * AWords;
+      const uint64_t* BRow = B.Bits.data () + (size_t) (AY + y + Dy) * BWords;
+
+      for (int x = 0; x < Width; x += 64) {
+         uint64_t Difference = BitsAt (ARow, AWords, AX + x) ^ BitsAt (BRow, BWords, AX + Dx + x);
+
+         if (Width - x < 64) {
+            Difference &= (1ULL << (Width - x)) - 1;
+         }
+
+         Count += PopCount (Difference);
+      }
+
+      if (Count > Limit) {
+         return Count;
+      }
+   }
+
+   return Count;
+}
+
+}
+
+TextCache::Key TextCache::Describe (const cv::Mat& Binary)
+{
+   Key Crop;
+
+   Crop.Size = Binary.size ();
+
+   int Words = WordsPerRow (Binary.cols);
+   Crop.Bits.assign ((size_t) Words * Binary.rows, 0);
+
+   for (int y = 0; y < Binary.rows; ++y) {
+      const uint8_t* Row = Binary.ptr<uint8_t> (y);
+      uint64_t* Packed = Crop.Bits.data () + (size_t) y * Words;
+
+      for (int x = 0; x < Binary.cols; ++x) {
+         if (Row [x] < INK_LEVEL) {
+            Packed [x >> 6] |= 1ULL << (x & 63);
+         }
+      }
+   }
+
+   cv::Mat Small;
+   cv::Mat Coefficients;
+
+   cv::resize (Binary, Small, cv::Size (HASH_IMAGE_SIZE, HASH_IMAGE_SIZE), 0, 0, cv::INTER_AREA);
+   Small.convertTo (Small, CV_32F);
+   cv::dct (Small, Coefficients);
+
+   std::array<float, HASH_FREQUENCIES * HASH_FREQUENCIES> Low;
+
+   for (int y = 0; y < HASH_FREQUENCIES; ++y) {
+      for (int x = 0; x < HASH_FREQUENCIES; ++x) {
+         Low [y * HASH_FREQUENCIES + x] = Coefficients.at<float> (y, x);
+      }
+   }
+
+   // The DC term only says how much ink there is, the median of the others
+   // splits them into the hash bits.
+   std::array<float, HASH_FREQUENCIES * HASH_FREQUENCIES - 1> Sorted;
+   std::copy (Low.begin () + 1, Low.end (), Sorted.begin ());
+   std::nth_element (Sorted.begin (), Sorted.begin () + Sorted.size () / 2, Sorted.end ());
+
+   float Median = Sorted [Sorted.size () / 2];
+
+   Crop.Hash = 0;
+
+   for (size_t i = 1; i < Low.size (); ++i) {
+      if (Low [i] > Median) {
+         Crop.Hash |= 1ULL << i;
+      }
+   }
+
+   return Crop;
+}
+
+bool TextCache::Matches (const Key& A, const Key& B)
+{
+   if (
+      PopCount (A.Hash ^ B.Hash) > MAXIMUM_HASH_DISTANCE ||
+      std::abs (A.Size.width - B.Size.width) > 2 * MAXIMUM_SHIFT ||
+      std::abs (A.Size.height - B.Size.height) > 2 * MAXIMUM_SHIFT
+   ) {
+      return false;
+   }
+
+   // A few pixels along glyph edges may flip between captures, a changed
+   // digit flips far more.
+   int Limit = std::max (4, A.Size.area () / 20000);
+
+   for (int Dy = -MAXIMUM_SHIFT; Dy <= MAXIMUM_SHIFT; ++Dy) {
+      for (int Dx = -MAXIMUM_SHIFT; Dx <= MAXIMUM_SHIFT; ++Dx) {
+         if (Mismatches (A, B, Dx, Dy, Limit) <= Limit) {
+            return true;
+         }
+      }
+   }
+
+   return false;
+}
+
+size_t TextCache::Footprint (const Entry& Cached)
+{
+   size_t Bytes = sizeof (Entry) + Cached.Crop.Bits.size () * sizeof (uint64_t);
+
+   for (const std::string& Part : Cached.Text.Sections) {
+      Bytes += Part.size ();
+   }
+
+   return Bytes;
+}
+
+void TextCache::SetCapacity (size_t Bytes)
+{
+   std::lock_guard<std::mutex> Guard (Lock);
+
+   Limit = Bytes;
+   Evict ();
+}
+
+size_t TextCache::Capacity ()
+{
+   std::lock_guard<std::mutex> Guard (Lock);
+   return Limit;
+}
+
+std::optional<TooltipText> TextCache::Find (const Key& Crop)
+{
+   std::lock_guard<std::mutex> Guard (Lock);
+
+   for (auto Cached = Entries.begin (); Cached != Entries.end (); ++Cached) {
+      if (Matches (Crop, Cached->Crop)) {
+         Entries.splice (Entries.begin (), Entries, Cached);
+         return Entries.front ().Text;
+      }
+   }
+
+   return std::nullopt;
+}
+
+void TextCache::Insert (Key&& Crop, const TooltipText& Text)
+{
+   std::lock_guard<std::mutex> Guard (Lock);
+
+   Entries.push_front ({ std::move (Crop), Text });
+   Used += Footprint (Entries.front ());
+
+   Evict ();
+}
+
+void TextCache::Evict ()
+{
+   while (Used > Limit && !Entries.empty ()) {
+      Used -= Footprint (Entries.back ());
+      Entries.pop_back ();
+   }
+}
+
+void TextCache::Clear ()
+{
+   std::lock_guard<std::mutex> Guard (Lock);
+
+   Entries.clear ();
+   Used = 0;
+}
\ No newline at end of file
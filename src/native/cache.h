@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ocr.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <opencv2/core/mat.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+// LRU cache of OCR results keyed by the binarized tooltip crop. Candidates
+// are found by a perceptual hash, which tolerates the crop moving by a pixel
+// or two between hovers. A hit is then verified against the stored bitmap,
+// so tooltips that differ in a single digit are never confused.
+class TextCache
+{
+   public:
+
+   // Hashes differing in more bits than this are different tooltips.
+   static constexpr int MAXIMUM_HASH_DISTANCE = 6;
+
+   // How far the crop may be shifted against the cached one, in pixels.
+   static constexpr int MAXIMUM_SHIFT = 2;
+
+   struct Key
+   {
+      uint64_t Hash;
+      cv::Size Size;
+
+      // Ink pixels packed 64 per word, every row starts on a new word.
+      std::vector<uint64_t> Bits;
+   };
+
+   static Key Describe (const cv::Mat& Binary);
+
+   // Entries are evicted once their bitmaps and texts use more than Bytes,
+   // zero disables the cache.
+   void SetCapacity (size_t Bytes);
+   size_t Capacity ();
+
+   std::optional<TooltipText> Find (const Key& Crop);
+   void Insert (Key&& Crop, const TooltipText& Text);
+
+   void Clear ();
+
+   private:
+
+   struct Entry
+   {
+      Key Crop;
+      TooltipText Text;
+   };
+
+   std::mutex Lock;
+
+   size_t Limit = 0;
+   size_t Used = 0;
+
+   // Most recently used first.
+   std::list<Entry> Entries;
+
+   static size_t Footprint (const Entry& Cached);
+   static bool Matches (const Key& A, const Key& B);
+   void Evict ();
+};
\ No newline at end of file
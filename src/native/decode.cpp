@@ -0,0 +1,236 @@
+#include "decode.h"
+#include <algorithm>
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/dnn.hpp>
+
+namespace {
+
+// Collects the indices of every score above the threshold. Survivors are rare
+// so lanes are only inspected one by one when a vector contains any of them.
+void SelectAnchors (const float* Scores, int Count, float Threshold, std::vector<int>& Anchors)
+{
+   Anchors.clear ();
+
+   int i = 0;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+   const int Lanes = cv::VTraits<cv::v_float32>::vlanes ();
+
+   cv::v_float32 VThreshold = cv::vx_setall_f32 (Threshold);
+
+   for (; i <= Count - Lanes; i += Lanes) {
+      if (!cv::v_check_any (cv::v_gt (cv::vx_load (Scores + i), VThreshold))) {
+         continue;
+      }
+
+      for (int Lane = 0; Lane < Lanes; ++Lane) {
+         if (Scores [i + Lane] > Threshold) {
+            Anchors.push_back (i + Lane);
+         }
+      }
+   }
+#endif
+
+   for (; i < Count; ++i) {
+      if (Scores [i] > Threshold) {
+         Anchors.push_back (i);
+      }
+   }
+}
+
+// Element wise maximum of two score rows.
+void MaximumScores (const float* Row, float* Scores, int Count)
+{
+   int i = 0;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+   const int Lanes = cv::VTraits<cv::v_float32>::vlanes ();
+
+   for (; i <= Count - Lanes; i += Lanes) {
+      cv::v_store (Scores + i, cv::v_max (cv::vx_load (Scores + i), cv::vx_load (Row + i)));
+   }
+#endif
+
+   for (; i < Count; ++i) {
+      Scores [i] = std::max (Scores [i], Row [i]);
+   }
+}
+
+}
+
+double Overlap (const cv::Rect& A, const cv::Rect& B)
+{
+   double AreaA = A.area ();
+   double AreaB = B.area ();
+
+   if (AreaA + AreaB <= 0) {
+      return 0;
+   }
+
+   double Intersection = (A & B).area ();
+
+   return Intersection / (AreaA + AreaB - Intersection);
+}
+
+std::vector<Detection> DecodeReference (
+   const cv::Mat& Output,
+   float MinimumConfidence,
+   float XScale,
+   float YScale,
+   float ScoreThreshold,
+   float OverlapThreshold
+) {
+   int Dimensions = Output.size [1];
+   int Rows = Output.size [2];
+
+   cv::Mat Transposed;
+   cv::transpose (Output.reshape (1, Dimensions), Transposed);
+
+   const float* Data = Transposed.ptr<float> ();
+
+   std::vector<int> ClassIds;
+   std::vector<float> Confidences;
+   std::vector<cv::Rect> Boxes;
+
+   for (int i = 0; i < Rows; ++i) {
+      cv::Mat Scores (1, Dimensions - 4, CV_32FC1, (void*) (Data + 4));
+      cv::Point ClassId;
+
+      double MaxClassScore;
+
+      cv::minMaxLoc (Scores, 0, &MaxClassScore, 0, &ClassId);
+
+      if (MaxClassScore > MinimumConfidence) {
+         Confidences.push_back ((float) MaxClassScore);
+         ClassIds.push_back (ClassId.x);
+
+         float X = Data [0];
+         float Y = Data [1];
+         float W = Data [2];
+         float H = Data [3];
+
+         int Left = (int) ((X - 0.5 * W) * XScale);
+         int Top = (int) ((Y - 0.5 * H) * YScale);
+
+         int Width = (int) (W * XScale);
+         int Height = (int) (H * YScale);
+
+         Boxes.push_back (cv::Rect (Left, Top, Width, Height));
+      }
+
+      Data += Dimensions;
+   }
+
+   std::vector<int> Nms;
+
+   cv::dnn::NMSBoxes (
+      Boxes,
+      Confidences,
+      ScoreThreshold,
+      OverlapThreshold,
+      Nms
+   );
+
+   std::vector<Detection> Kept;
+
+   for (int Idx : Nms) {
+      Kept.push_back ({ Boxes [Idx], Confidences [Idx], ClassIds [Idx] });
+   }
+
+   return Kept;
+}
+
+const std::vector<Detection>& YoloDecoder::Decode (
+   const cv::Mat& Output,
+   float MinimumConfidence,
+   float XScale,
+   float YScale
+) {
+   CV_Assert (Output.dims == 3 && Output.type () == CV_32F && Output.isContinuous ());
+
+   int Dimensions = Output.size [1];
+   int Count = Output.size [2];
+   int Classes = Dimensions - 4;
+
+   const float* Data = Output.ptr<float> ();
+
+   // Row c holds the score of class c for every anchor.
+   const float* ClassScores = Data + 4 * Count;
+   const float* Best = ClassScores;
+
+   if (Classes > 1) {
+      Scores.assign (ClassScores, ClassScores + Count);
+
+      for (int Class = 1; Class < Classes; ++Class) {
+         MaximumScores (ClassScores + Class * Count, Scores.data (), Count);
+      }
+
+      Best = Scores.data ();
+   }
+
+   SelectAnchors (Best, Count, MinimumConfidence, Anchors);
+
+   Candidates.clear ();
+
+   for (int Anchor : Anchors) {
+      int ClassId = 0;
+
+      for (int Class = 1; Class < Classes; ++Class) {
+         if (ClassScores [Class * Count + Anchor] > ClassScores [ClassId * Count + Anchor]) {
+            ClassId = Class;
+         }
+      }
+
+      float X = Data [Anchor];
+      float Y = Data [Count + Anchor];
+      float W = Data [2 * Count + Anchor];
+      float H = Data [3 * Count + Anchor];
+
+      int Left = (int) ((X - 0.5 * W) * XScale);
+      int Top = (int) ((Y - 0.5 * H) * YScale);
+
+      int Width = (int) (W * XScale);
+      int Height = (int) (H * YScale);
+
+      Candidates.push_back ({
+         cv::Rect (Left, Top, Width, Height),
+         Best [Anchor],
+         ClassId
+      });
+   }
+
+   return Candidates;
+}
+
+const std::vector<Detection>& YoloDecoder::Suppress (float ScoreThreshold, float OverlapThreshold)
+{
+   Order.clear ();
+
+   for (int i = 0; i < (int) Candidates.size (); ++i) {
+      if (Candidates [i].Confidence > ScoreThreshold) {
+         Order.push_back (i);
+      }
+   }
+
+   // Stable like NMSBoxes so ties keep their anchor order.
+   std::stable_sort (Order.begin (), Order.end (), [ this ] (int A, int B) {
+      return Candidates [A].Confidence > Candidates [B].Confidence;
+   });
+
+   Kept.clear ();
+
+   for (int Idx : Order) {
+      const Detection& Candidate = Candidates [Idx];
+
+      bool Keep = std::none_of (Kept.begin (), Kept.end (), [ & ] (const Detection& Other) {
+         return Overlap (Candidate.Box, Other.Box) > OverlapThreshold;
+      });
+
+      if (Keep) {
+         Kept.push_back (Candidate);
+      }
+   }
+
+   return Kept;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+#include <vector>
+
+struct Detection
+{
+   cv::Rect Box;
+   float Confidence;
+   int ClassId;
+};
+
+// Intersection over union, computed like cv::dnn's rectOverlap.
+double Overlap (const cv::Rect& A, const cv::Rect& B);
+
+// The transpose, per anchor minMaxLoc and cv::dnn::NMSBoxes YoloDecoder
+// replaced, decoding and suppressing in one call. Only used to compare the
+// two.
+std::vector<Detection> DecodeReference (
+   const cv::Mat& Output,
+   float MinimumConfidence,
+   float XScale,
+   float YScale,
+   float ScoreThreshold,
+   float OverlapThreshold
+);
+
+// Decodes YOLO style [1 x (4 + Classes) x Anchors] outputs in their channel
+// major layout. Every buffer is kept between calls so steady state decoding
+// does not allocate, which also means an instance must not be shared between
+// threads without external locking.
+class YoloDecoder
+{
+   public:
+
+   // Returns the boxes of every anchor whose best class score is above
+   // MinimumConfidence, scaled from model input to screenshot coordinates.
+   const std::vector<Detection>& Decode (
+      const cv::Mat& Output,
+      float MinimumConfidence,
+      float XScale,
+      float YScale
+   );
+
+   // Greedy non-maximum suppression over the last decoded boxes, keeping the
+   // same boxes as cv::dnn::NMSBoxes would for a single class.
+   const std::vector<Detection>& Suppress (float ScoreThreshold, float OverlapThreshold);
+
+   private:
+
+   std::vector<float> Scores;
+   std::vector<int> Anchors;
+   std::vector<int> Order;
+
+   std::vector<Detection> Candidates;
+   std::vector<Detection> Kept;
+};
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "frame.h"
+
+std::shared_ptr<Frame> FramePool::Acquire (int Width, int Height)
+{
+   // 4 bytes per pixel (BGRA)
+   size_t Size = static_cast<size_t> (Width) * Height * 4;
+
+   std::unique_ptr<Frame> Acquired;
+
+   {
+      std::lock_guard<std::mutex> Guard (Lock);
+
+      while (!Free.empty () && !Acquired) {
+         std::unique_ptr<Frame> Candidate = std::move (Free.back ());
+         Free.pop_back ();
+
+         // Frames from a monitor with a different resolution are dropped.
+         if (Candidate->Buffer.size () == Size) {
+            Acquired = std::move (Candidate);
+         }
+      }
+   }
+
+   if (!Acquired) {
+      Acquired = std::make_unique<Frame> ();
+      Acquired->Buffer.resize (Size);
+   }
+
+   Acquired->Image = cv::Mat (
+      Height,
+      Width,
+      CV_8UC4,
+      Acquired->Buffer.data ()
+   );
+
+   std::weak_ptr<FramePool> Pool = weak_from_this ();
+
+   return std::shared_ptr<Frame> (Acquired.release (), [ Pool ] (Frame* Released) {
+      if (auto Owner = Pool.lock ()) {
+         Owner->Release (Released);
+      } else {
+         delete Released;
+      }
+   });
+}
+
+void FramePool::Release (Frame* Released)
+{
+   std::unique_ptr<Frame> Owned (Released);
+
+   std::lock_guard<std::mutex> Guard (Lock);
+
+   if (Free.size () < MAXIMUM_FREE_FRAMES) {
+      Free.push_back (std::move (Owned));
+   }
+}
+
+void FrameSlot::Publish (FrameRef Published)
+{
+   std::lock_guard<std::mutex> Guard (WriteLock);
+
+   Slots [Back] = std::move (Published);
+
+   uint8_t Previous = Middle.exchange (Back | FRESH, std::memory_order_acq_rel);
+
+   Back = Previous & INDEX;
+
+   // The frame left in the back slot was superseded before anyone read it,
+   // release it now so its buffer goes straight back to the pool.
+   Slots [Back].reset ();
+}
+
+FrameRef FrameSlot::Read (bool& IsNew)
+{
+   IsNew = false;
+
+   if (Middle.load (std::memory_order_acquire) & FRESH) {
+      uint8_t Previous = Middle.exchange (Front, std::memory_order_acq_rel);
+
+      Front = Previous & INDEX;
+      IsNew = true;
+   }
+
+   return Slots [Front];
+}
+
+void FrameSlot::Reset ()
+{
+   for (auto& Slot : Slots) {
+      Slot.reset ();
+   }
+
+   Back = 0;
+   Front = 1;
+
+   Middle.store (2, std::memory_order_release);
+}
\ No newline at end of file
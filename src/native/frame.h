@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+// A captured frame. Pooled frames own their pixels in Buffer and Image is a
+// header over it, other capture methods can hand over an owning cv::Mat.
+struct Frame
+{
+   std::vector<uint8_t> Buffer;
+   cv::Mat Image;
+};
+
+// Frames are shared read-only between the capture callback and every consumer,
+// the pixels are never copied once they have been extracted.
+using FrameRef = std::shared_ptr<const Frame>;
+
+class FramePool : public std::enable_shared_from_this<FramePool>
+{
+   public:
+
+   // Returns a BGRA frame of the given size. Buffers of frames that are no
+   // longer referenced are recycled instead of being reallocated.
+   std::shared_ptr<Frame> Acquire (int Width, int Height);
+
+   private:
+
+   // Released buffers above this count are freed rather than kept around.
+   static constexpr size_t MAXIMUM_FREE_FRAMES = 4;
+
+   std::mutex Lock;
+   std::vector<std::unique_ptr<Frame>> Free;
+
+   void Release (Frame* Released);
+};
+
+// Triple buffer holding the most recently published frame. Reading is
+// lock-free and there must be a single reader. Writers are serialized, the
+// capture callback runs on a thread per monitor and publishes from all of
+// them while the game monitor is unknown.
+class FrameSlot
+{
+   public:
+
+   void Publish (FrameRef Published);
+
+   // Returns the latest frame, IsNew is false when nothing was published
+   // since the previous read and the same frame is returned again.
+   FrameRef Read (bool& IsNew);
+
+   // Not thread safe, only call while nothing is publishing.
+   void Reset ();
+
+   private:
+
+   static constexpr uint8_t FRESH = 0x4;
+   static constexpr uint8_t INDEX = 0x3;
+
+   std::array<FrameRef, 3> Slots;
+
+   // Held by Publish, guards Back and the back slot
+   std::mutex WriteLock;
+
+   uint8_t Back = 0;
+   uint8_t Front = 1;
+
+   std::atomic<uint8_t> Middle = 2;
+};
\ No newline at end of file
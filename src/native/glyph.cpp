@@ -0,0 +1,514 @@
+#include "glyph.h"
+#include "logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+#include <windows.h>
+
+namespace {
+
+// Printable ASCII covers everything the game writes in English.
+const char FIRST_CHARACTER = '!';
+const char LAST_CHARACTER = '~';
+
+const int INK_LEVEL = 128;
+
+// Em size fonts are measured at.
+const int MEASURE_SIZE = 64;
+
+// Smaller components are binarization noise.
+const int MINIMUM_COMPONENT_AREA = 2;
+
+uint16_t ReadU16 (const std::vector<uint8_t>& Data, size_t Offset)
+{
+   return (uint16_t) (Data [Offset] << 8 | Data [Offset + 1]);
+}
+
+uint32_t ReadU32 (const std::vector<uint8_t>& Data, size_t Offset)
+{
+   return (uint32_t) ReadU16 (Data, Offset) << 16 | ReadU16 (Data, Offset + 2);
+}
+
+// GDI only knows fonts by their family, which is read from the US English
+// entry of the TrueType name table.
+std::wstring ReadFamilyName (const std::string& File)
+{
+   std::ifstream Stream (File, std::ios::binary);
+   std::vector<uint8_t> Data ((std::istreambuf_iterator<char> (Stream)), std::istreambuf_iterator<char> ());
+
+   if (Data.size () < 12) {
+      return std::wstring ();
+   }
+
+   uint16_t Tables = ReadU16 (Data, 4);
+
+   for (uint16_t i = 0; i < Tables; ++i) {
+      size_t Record = 12 + 16 * (size_t) i;
+
+      if (Record + 16 > Data.size ()) {
+         break;
+      }
+
+      if (std::memcmp (&Data [Record], "name", 4) != 0) {
+         continue;
+      }
+
+      size_t Table = ReadU32 (Data, Record + 8);
+
+      if (Table + 6 > Data.size ()) {
+         break;
+      }
+
+      uint16_t Count = ReadU16 (Data, Table + 2);
+      size_t Strings = Table + ReadU16 (Data, Table + 4);
+
+      for (uint16_t j = 0; j < Count; ++j) {
+         size_t Name = Table + 6 + 12 * (size_t) j;
+
+         if (Name + 12 > Data.size ()) {
+            break;
+         }
+
+         uint16_t Platform = ReadU16 (Data, Name);
+         uint16_t Language = ReadU16 (Data, Name + 4);
+         uint16_t Id = ReadU16 (Data, Name + 6);
+         uint16_t Length = ReadU16 (Data, Name + 8);
+         size_t Offset = Strings + ReadU16 (Data, Name + 10);
+
+         // Windows platform, US English, font family
+         if (Platform != 3 || Language != 0x409 || Id != 1 || Offset + Length > Data.size ()) {
+            continue;
+         }
+
+         std::wstring Family;
+
+         for (size_t k = 0; k + 1 < Length; k += 2) {
+            Family.push_back ((wchar_t) ReadU16 (Data, Offset + k));
+         }
+
+         return Family;
+      }
+   }
+
+   return std::wstring ();
+}
+
+std::wstring Widen (const std::string& Text)
+{
+   int Length = MultiByteToWideChar (CP_UTF8, 0, Text.c_str (), -1, nullptr, 0);
+
+   if (Length <= 0) {
+      return std::wstring ();
+   }
+
+   std::wstring Wide (Length - 1, L'\0');
+   MultiByteToWideChar (CP_UTF8, 0, Text.c_str (), -1, Wide.data (), Length);
+
+   return Wide;
+}
+
+// Draws single characters black on white, without anti-aliasing so they
+// look like binarized screen text.
+class Canvas
+{
+   public:
+
+   Canvas (const std::wstring& Family, int EmSize) : Size (EmSize * 3), Baseline (EmSize * 2)
+   {
+      Dc = CreateCompatibleDC (nullptr);
+
+      BITMAPINFO Info = {};
+      Info.bmiHeader.biSize = sizeof (BITMAPINFOHEADER);
+      Info.bmiHeader.biWidth = Size;
+      Info.bmiHeader.biHeight = -Size;
+      Info.bmiHeader.biPlanes = 1;
+      Info.bmiHeader.biBitCount = 32;
+      Info.bmiHeader.biCompression = BI_RGB;
+
+      Bitmap = CreateDIBSection (Dc, &Info, DIB_RGB_COLORS, &Bits, nullptr, 0);
+      OldBitmap = SelectObject (Dc, Bitmap);
+
+      Font = CreateFontW (
+         -EmSize, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, 
+         DEFAULT_CHARSET, OUT_TT_ONLY_PRECIS, CLIP_DEFAULT_PRECIS, 
+         NONANTIALIASED_QUALITY, DEFAULT_PITCH, Family.c_str ()
+      );
+
+      OldFont = SelectObject (Dc, Font);
+
+      SetTextColor (Dc, RGB (0, 0, 0));
+      SetBkMode (Dc, TRANSPARENT);
+      SetTextAlign (Dc, TA_BASELINE | TA_LEFT);
+   }
+
+   ~Canvas ()
+   {
+      SelectObject (Dc, OldFont);
+      DeleteObject (Font);
+      SelectObject (Dc, OldBitmap);
+      DeleteObject (Bitmap);
+      DeleteDC (Dc);
+   }
+
+   // GDI silently substitutes another font for a family it does not know.
+   bool Uses (const std::wstring& Family)
+   {
+      wchar_t Face [LF_FACESIZE] = {};
+
+      return Bits && GetTextFaceW (Dc, LF_FACESIZE, Face) > 0 && Family == Face;
+   }
+
+   // Returns the ink of the character, valid until the next call.
+   const cv::Mat& Draw (wchar_t Character)
+   {
+      PatBlt (Dc, 0, 0, Size, Size, WHITENESS);
+      TextOutW (Dc, Size / 6, Baseline, &Character, 1);
+      GdiFlush ();
+
+      cv::Mat Pixels (Size, Size, CV_8UC4, Bits);
+
+      cv::extractChannel (Pixels, Ink, 0);
+      cv::compare (Ink, INK_LEVEL, Ink, cv::CMP_LT);
+
+      return Ink;
+   }
+
+   const int Size;
+   const int Baseline;
+
+   private:
+
+   HDC Dc;
+   HBITMAP Bitmap;
+   HGDIOBJ OldBitmap;
+   HFONT Font;
+   HGDIOBJ OldFont;
+
+   void* Bits = nullptr;
+
+   cv::Mat Ink;
+};
+
+}
+
+GlyphReader::~GlyphReader ()
+{
+   Clear ();
+}
+
+bool GlyphReader::Initialize (const std::vector<std::string>& FontFiles)
+{
+   Clear ();
+
+   std::lock_guard<std::mutex> Guard (Lock);
+
+   for (const std::string& File : FontFiles) {
+      std::wstring Family = ReadFamilyName (File);
+
+      if (Family.empty () || AddFontResourceExW (Widen (File).c_str (), FR_PRIVATE, nullptr) == 0) {
+         Logger::log (
+            Logger::Level::E_WARNING,
+            "Failed to load glyph font: " + File
+         );
+
+         continue;
+      }
+
+      Canvas Surface (Family, MEASURE_SIZE);
+
+      cv::Rect Capital = Surface.Uses (Family) ? cv::boundingRect (Surface.Draw (L'H')) : cv::Rect ();
+
+      if (Capital.empty ()) {
+         Logger::log (
+            Logger::Level::E_WARNING,
+            "Failed to render glyph font: " + File
+         );
+
+         RemoveFontResourceExW (Widen (File).c_str (), FR_PRIVATE, nullptr);
+         continue;
+      }
+
+      Fonts.push_back ({ File, Family, (float) Capital.height / MEASURE_SIZE });
+
+      Logger::log (
+         Logger::Level::E_INFO,
+         "Loaded glyph font: " + File
+      );
+   }
+
+   return !Fonts.empty ();
+}
+
+void GlyphReader::Clear ()
+{
+   std::lock_guard<std::mutex> Guard (Lock);
+
+   for (const Font& Face : Fonts) {
+      RemoveFontResourceExW (Widen (Face.File).c_str (), FR_PRIVATE, nullptr);
+   }
+
+   Fonts.clear ();
+   Glyphs.clear ();
+}
+
+bool GlyphReader::Empty ()
+{
+   std::lock_guard<std::mutex> Guard (Lock);
+   return Fonts.empty ();
+}
+
+std::shared_ptr<const std::vector<GlyphReader::Glyph>> GlyphReader::GlyphsFor (int Height)
+{
+   std::lock_guard<std::mutex> Guard (Lock);
+
+   auto Found = Glyphs.find (Height);
+
+   if (Found != Glyphs.end ()) {
+      return Found->second;
+   }
+
+   // Tooltips only use a few sizes at one UI scale, so this stays small.
+   auto Rendered = std::make_shared<std::vector<Glyph>> ();
+
+   for (const Font& Face : Fonts) {
+      std::vector<Glyph> FontGlyphs = Render (Face, Height);
+      Rendered->insert (Rendered->end (), FontGlyphs.begin (), FontGlyphs.end ());
+   }
+
+   Glyphs [Height] = Rendered;
+
+   return Rendered;
+}
+
+std::vector<GlyphReader::Glyph> GlyphReader::Render (const Font& Face, int Height)
+{
+   std::vector<Glyph> Rendered;
+
+   int EmSize = std::max (1, (int) std::lround (Height / Face.CapitalRatio));
+
+   Canvas Surface (Face.Family, EmSize);
+
+   for (char Character = FIRST_CHARACTER; Character <= LAST_CHARACTER; ++Character) {
+      const cv::Mat& Ink = Surface.Draw ((wchar_t) Character);
+      cv::Rect Box = cv::boundingRect (Ink);
+
+      if (Box.empty ()) {
+         continue;
+      }
+
+      Glyph Rendering;
+
+      Rendering.Character = Character;
+      Rendering.Top = (float) (Surface.Baseline - Box.y) / Height;
+      Rendering.Bottom = (float) (Surface.Baseline - Box.br ().y) / Height;
+      Rendering.Aspect = (float) Box.width / Box.height;
+      Rendering.Solid = !Normalize (Ink (Box), Rendering.Normalized);
+
+      Rendered.push_back (Rendering);
+   }
+
+   return Rendered;
+}
+
+bool GlyphReader::Normalize (const cv::Mat& Ink, Pixels& Normalized)
+{
+   cv::Mat Scaled;
+   cv::resize (Ink, Scaled, cv::Size (TEMPLATE_SIZE, TEMPLATE_SIZE), 0, 0, cv::INTER_AREA);
+
+   float Mean = 0;
+
+   for (int i = 0; i < TEMPLATE_SIZE * TEMPLATE_SIZE; ++i) {
+      Normalized [i] = Scaled.data [i] / 255.0f;
+      Mean += Normalized [i];
+   }
+
+   Mean /= TEMPLATE_SIZE * TEMPLATE_SIZE;
+
+   float Energy = 0;
+
+   for (float& Value : Normalized) {
+      Value -= Mean;
+      Energy += Value * Value;
+   }
+
+   // Dots, dashes and bars fill their box and have no shape to correlate.
+   if (Energy < 1e-3f) {
+      Normalized.fill (0);
+      return false;
+   }
+
+   float Scale = 1.0f / std::sqrt (Energy);
+
+   for (float& Value : Normalized) {
+      Value *= Scale;
+   }
+
+   return true;
+}
+
+float GlyphReader::Correlate (const Pixels& A, const Pixels& B)
+{
+   int i = 0;
+   float Sum = 0;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+   const int Lanes = cv::VTraits<cv::v_float32>::vlanes ();
+
+   cv::v_float32 Accumulator = cv::vx_setzero_f32 ();
+
+   for (; i + Lanes <= (int) A.size (); i += Lanes) {
+      Accumulator = cv::v_fma (cv::vx_load (A.data () + i), cv::vx_load (B.data () + i), Accumulator);
+   }
+
+   Sum = cv::v_reduce_sum (Accumulator);
+#endif
+
+   for (; i < (int) A.size (); ++i) {
+      Sum += A [i] * B [i];
+   }
+
+   return Sum;
+}
+
+std::optional<std::string> GlyphReader::Read (const cv::Mat& Line)
+{
+   if (Empty ()) {
+      return std::nullopt;
+   }
+
+   cv::Mat Ink;
+   cv::compare (Line, INK_LEVEL, Ink, cv::CMP_LT);
+
+   cv::Mat Labels;
+   cv::Mat Boxes;
+   cv::Mat Centroids;
+
+   int Count = cv::connectedComponentsWithStats (Ink, Labels, Boxes, Centroids, 8, CV_32S);
+
+   std::vector<cv::Rect> Parts;
+
+   for (int i = 1; i < Count; ++i) {
+      cv::Rect Box (
+         Boxes.at<int> (i, cv::CC_STAT_LEFT),
+         Boxes.at<int> (i, cv::CC_STAT_TOP),
+         Boxes.at<int> (i, cv::CC_STAT_WIDTH),
+         Boxes.at<int> (i, cv::CC_STAT_HEIGHT)
+      );
+
+      // Strips are padded, anything touching their top or bottom row belongs
+      // to a neighbouring line.
+      if (Box.y == 0 || Box.br ().y == Ink.rows) {
+         continue;
+      }
+
+      if (Boxes.at<int> (i, cv::CC_STAT_AREA) >= MINIMUM_COMPONENT_AREA) {
+         Parts.push_back (Box);
+      }
+   }
+
+   if (Parts.empty ()) {
+      return std::nullopt;
+   }
+
+   std::sort (Parts.begin (), Parts.end (), [] (const cv::Rect& A, const cv::Rect& B) {
+      return A.x < B.x;
+   });
+
+   // Dots and accents sit above or below the rest of their glyph.
+   std::vector<cv::Rect> Characters;
+
+   for (const cv::Rect& Part : Parts) {
+      if (!Characters.empty ()) {
+         cv::Rect& Previous = Characters.back ();
+
+         int Overlap = std::min (Previous.br ().x, Part.br ().x) - std::max (Previous.x, Part.x);
+
+         if (Overlap * 2 >= std::min (Previous.width, Part.width)) {
+            Previous |= Part;
+            continue;
+         }
+      }
+
+      Characters.push_back (Part);
+   }
+
+   // Most glyphs sit on the baseline and the tallest ones reach about the
+   // capital height above it.
+   std::vector<int> Bottoms;
+   int Top = Ink.rows;
+
+   for (const cv::Rect& Box : Characters) {
+      Bottoms.push_back (Box.br ().y);
+      Top = std::min (Top, Box.y);
+   }
+
+   std::nth_element (Bottoms.begin (), Bottoms.begin () + Bottoms.size () / 2, Bottoms.end ());
+
+   int Baseline = Bottoms [Bottoms.size () / 2];
+   int Height = Baseline - Top;
+
+   if (Height < MINIMUM_LINE_HEIGHT) {
+      return std::nullopt;
+   }
+
+   std::shared_ptr<const std::vector<Glyph>> Candidates = GlyphsFor (Height);
+
+   std::string Text;
+   Pixels Normalized;
+
+   for (size_t i = 0; i < Characters.size (); ++i) {
+      const cv::Rect& Box = Characters [i];
+
+      if (i > 0 && Box.x - Characters [i - 1].br ().x > SPACE_RATIO * Height) {
+         Text += ' ';
+      }
+
+      bool Solid = !Normalize (Ink (Box), Normalized);
+
+      float BoxTop = (float) (Baseline - Box.y) / Height;
+      float BoxBottom = (float) (Baseline - Box.br ().y) / Height;
+      float Aspect = (float) Box.width / Box.height;
+
+      float Best = -std::numeric_limits<float>::infinity ();
+      char Character = 0;
+
+      for (const Glyph& Candidate : *Candidates) {
+         float Penalty = 
+            POSITION_WEIGHT * (std::abs (BoxTop - Candidate.Top) + std::abs (BoxBottom - Candidate.Bottom)) + 
+            ASPECT_WEIGHT * std::abs (std::log (Aspect / Candidate.Aspect));
+
+         // The correlation is at most one, skip glyphs that cannot win.
+         if (1.0f - Penalty <= std::max (Best, MINIMUM_SCORE)) {
+            continue;
+         }
+
+         float Shape;
+
+         if (Solid || Candidate.Solid) {
+            Shape = Solid == Candidate.Solid ? 1.0f : 0.0f;
+         } else {
+            Shape = Correlate (Normalized, Candidate.Normalized);
+         }
+
+         if (Shape - Penalty > Best) {
+            Best = Shape - Penalty;
+            Character = Candidate.Character;
+         }
+      }
+
+      if (Best < MINIMUM_SCORE) {
+         return std::nullopt;
+      }
+
+      Text += Character;
+   }
+
+   return Text;
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <opencv2/core/mat.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Reads single lines of tooltip text by matching their connected components
+// against glyphs rendered from the game's fonts. Only meant for the common
+// case, lines it is not sure about are left to Tesseract.
+class GlyphReader
+{
+   public:
+
+   // Glyphs are compared as normalized images of this size.
+   static constexpr int TEMPLATE_SIZE = 16;
+
+   // Lowest score accepted for a glyph, a line with any glyph below it is
+   // not read.
+   static constexpr float MINIMUM_SCORE = 0.75f;
+
+   // Weights of the position and shape mismatches against the correlation.
+   static constexpr float POSITION_WEIGHT = 0.5f;
+   static constexpr float ASPECT_WEIGHT = 0.25f;
+
+   // Gaps wider than this share of the line height are spaces.
+   static constexpr float SPACE_RATIO = 0.28f;
+
+   // Lines are not read below this height, glyphs are too coarse to tell
+   // apart.
+   static constexpr int MINIMUM_LINE_HEIGHT = 6;
+
+   ~GlyphReader ();
+
+   // Loads the fonts privately for this process. Returns false when none of
+   // them could be loaded.
+   bool Initialize (const std::vector<std::string>& FontFiles);
+
+   void Clear ();
+   bool Empty ();
+
+   // Reads one binarized text line strip with dark text on a light
+   // background. Returns nullopt when the line is empty or any glyph is not
+   // recognized with enough confidence.
+   std::optional<std::string> Read (const cv::Mat& Line);
+
+   private:
+
+   using Pixels = std::array<float, TEMPLATE_SIZE * TEMPLATE_SIZE>;
+
+   // Vertical extents are relative to the baseline in line heights, positive
+   // upwards. The line height is the height of a capital above the baseline.
+   struct Glyph
+   {
+      char Character;
+      float Top;
+      float Bottom;
+      float Aspect;
+
+
+      // Glyphs that fill their box, like dots and dashes, only compare by
+      // position and aspect.
+      bool Solid;
+      Pixels Normalized;
+   };
+
+   struct Font
+   {
+      std::string File;
+      std::wstring Family;
+
+      // Capital height as a share of the em size.
+      float CapitalRatio;
+   };
+
+   std::mutex Lock;
+
+   std::vector<Font> Fonts;
+
+   // Glyphs of every font rendered for a line height in pixels, rendered on
+   // first use.
+   std::map<int, std::shared_ptr<const std::vector<Glyph>>> Glyphs;
+
+   std::shared_ptr<const std::vector<Glyph>> GlyphsFor (int Height);
+
+   static std::vector<Glyph> Render (const Font& Face, int Height);
+   static bool Normalize (const cv::Mat& Ink, Pixels& Normalized);
+   static float Correlate (const Pixels& A, const Pixels& B);
+};
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include "inference.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/dnn.hpp>
+#include <thread>
+
+#ifdef GRIMVAULT_ONNXRUNTIME
+#include <onnxruntime_cxx_api.h>
+#endif
+
+#ifdef GRIMVAULT_OPENVINO
+#include <openvino/openvino.hpp>
+#endif
+
+namespace {
+
+// Leave half of the cores to the game.
+int InferenceThreads ()
+{
+   return (int) std::max (1u, std::thread::hardware_concurrency () / 2);
+}
+
+class OpenCVEngine : public InferenceEngine
+{
+   public:
+
+   std::string Name () const override
+   {
+      return "opencv";
+   }
+
+   bool Load (const std::string& OnnxFile) override
+   {
+      Net = cv::dnn::readNetFromONNX (OnnxFile);
+
+      if (Net.empty ()) {
+         return false;
+      }
+
+      if (cv::cuda::getCudaEnabledDeviceCount () > 0) {
+         Logger::log (
+            Logger::Level::E_INFO,
+            "CUDA is available, enabling GPU acceleration"
+         );
+
+         Net.setPreferableBackend (cv::dnn::DNN_BACKEND_CUDA);
+         Net.setPreferableTarget (cv::dnn::DNN_TARGET_CUDA);
+      } else {
+         Logger::log (
+            Logger::Level::E_INFO,
+            "CUDA not available, using CPU"
+         );
+
+         Net.setPreferableBackend (cv::dnn::DNN_BACKEND_OPENCV);
+         Net.setPreferableTarget (cv::dnn::DNN_TARGET_CPU);
+      }
+
+      OutputNames = Net.getUnconnectedOutLayersNames ();
+
+      return true;
+   }
+
+   cv::Mat Run (const cv::Mat& Blob) override
+   {
+      Net.setInput (Blob);
+      Net.forward (Outputs, OutputNames);
+
+      return Outputs [0];
+   }
+
+   private:
+
+   cv::dnn::Net Net;
+
+   std::vector<std::string> OutputNames;
+   std::vector<cv::Mat> Outputs;
+};
+
+#ifdef GRIMVAULT_ONNXRUNTIME
+class OnnxRuntimeEngine : public InferenceEngine
+{
+   public:
+
+   std::string Name () const override
+   {
+      return "onnxruntime";
+   }
+
+   bool Load (const std::string& OnnxFile) override
+   {
+      try {
+         Ort::SessionOptions Options;
+
+         Options.SetGraphOptimizationLevel (GraphOptimizationLevel::ORT_ENABLE_ALL);
+         Options.SetExecutionMode (ExecutionMode::ORT_SEQUENTIAL);
+         Options.SetIntraOpNumThreads (InferenceThreads ());
+         Options.SetInterOpNumThreads (1);
+
+         std::filesystem::path Path (OnnxFile);
+
+         Session = std::make_unique<Ort::Session> (Environment, Path.c_str (), Options);
+
+         Ort::AllocatorWithDefaultOptions Allocator;
+
+         InputName = Session->GetInputNameAllocated (0, Allocator).get ();
+         OutputName = Session->GetOutputNameAllocated (0, Allocator).get ();
+
+         return true;
+      } catch (const Ort::Exception& E) {
+         Logger::log (
+            Logger::Level::E_ERROR,
+            std::string ("Failed to load model with ONNX Runtime: ") + E.what ()
+         );
+
+         Session.reset ();
+         return false;
+      }
+   }
+
+   cv::Mat Run (const cv::Mat& Blob) override
+   {
+      std::vector<int64_t> Shape (Blob.size.p, Blob.size.p + Blob.dims);
+
+      Ort::Value Input = Ort::Value::CreateTensor<float> (
+         Memory,
+         const_cast<float*> (Blob.ptr<float> ()),
+         Blob.total (),
+         Shape.data (),
+         Shape.size ()
+      );
+
+      const char* InputNames [] = { InputName.c_str () };
+      const char* OutputNames [] = { OutputName.c_str () };
+
+      std::vector<Ort::Value> Outputs = Session->Run (
+         Ort::RunOptions { nullptr },
+         InputNames,
+         &Input,
+         1,
+         OutputNames,
+         1
+      );
+
+      // Keep the output tensor alive so the result does not need a copy.
+      Output = std::move (Outputs [0]);
+
+      std::vector<int64_t> OutputShape = Output.GetTensorTypeAndShapeInfo ().GetShape ();
+      std::vector<int> Sizes (OutputShape.begin (), OutputShape.end ());
+
+      return cv::Mat (
+         (int) Sizes.size (),
+         Sizes.data (),
+         CV_32F,
+         Output.GetTensorMutableData<float> ()
+      );
+   }
+
+   private:
+
+   Ort::Env Environment { ORT_LOGGING_LEVEL_WARNING, "GrimVault" };
+   Ort::MemoryInfo Memory = Ort::MemoryInfo::CreateCpu (OrtArenaAllocator, OrtMemTypeDefault);
+   Ort::Value Output { nullptr };
+
+   std::unique_ptr<Ort::Session> Session;
+
+   std::string InputName;
+   std::string OutputName;
+};
+#endif
+
+#ifdef GRIMVAULT_OPENVINO
+class OpenVINOEngine : public InferenceEngine
+{
+   public:
+
+   std::string Name () const override
+   {
+      return "openvino";
+   }
+
+   bool Load (const std::string& OnnxFile) override
+   {
+      try {
+         ov::CompiledModel Compiled = Core.compile_model (
+            Core.read_model (OnnxFile),
+            "CPU",
+            ov::hint::performance_mode (ov::hint::PerformanceMode::LATENCY),
+            ov::inference_num_threads (InferenceThreads ())
+         );
+
+         Request = Compiled.create_infer_request ();
+
+         return true;
+      } catch (const std::exception& E) {
+         Logger::log (
+            Logger::Level::E_ERROR,
+            std::string ("Failed to load model with OpenVINO: ") + E.what ()
+         );
+
+         return false;
+      }
+   }
+
+   cv::Mat Run (const cv::Mat& Blob) override
+   {
+      ov::Shape Shape (Blob.size.p, Blob.size.p + Blob.dims);
+
+      Request.set_input_tensor (ov::Tensor (
+         ov::element::f32,
+         Shape,
+         const_cast<float*> (Blob.ptr<float> ())
+      ));
+
+      Request.infer ();
+
+      // The output tensor belongs to the request and is reused by the next run.
+      ov::Tensor Output = Request.get_output_tensor ();
+      ov::Shape OutputShape = Output.get_shape ();
+
+      std::vector<int> Sizes (OutputShape.begin (), OutputShape.end ());
+
+      return cv::Mat (
+         (int) Sizes.size (),
+         Sizes.data (),
+         CV_32F,
+         Output.data<float> ()
+      );
+   }
+
+   private:
+
+   ov::Core Core;
+   ov::InferRequest Request;
+};
+#endif
+
+}
+
+std::vector<std::string> AvailableInferenceEngines ()
+{
+   std::vector<std::string> Engines = { "opencv" };
+
+#ifdef GRIMVAULT_ONNXRUNTIME
+   Engines.push_back ("onnxruntime");
+#endif
+
+#ifdef GRIMVAULT_OPENVINO
+   Engines.push_back ("openvino");
+#endif
+
+   return Engines;
+}
+
+std::unique_ptr<InferenceEngine> CreateInferenceEngine (const std::string& Name)
+{
+   if (Name == "opencv") {
+      return std::make_unique<OpenCVEngine> ();
+   }
+
+#ifdef GRIMVAULT_ONNXRUNTIME
+   if (Name == "onnxruntime") {
+      return std::make_unique<OnnxRuntimeEngine> ();
+   }
+#endif
+
+#ifdef GRIMVAULT_OPENVINO
+   if (Name == "openvino") {
+      return std::make_unique<OpenVINOEngine> ();
+   }
+#endif
+
+   return nullptr;
+}
+
+InferenceBenchmark BenchmarkInferenceEngine (InferenceEngine& Engine, int Width, int Height, int Runs)
+{
+   const int WARM_UP_RUNS = 3;
+
+   cv::Mat Blob (std::vector<int> { 1, 3, Height, Width }, CV_32F, cv::Scalar (0.5));
+
+   for (int i = 0; i < WARM_UP_RUNS; ++i) {
+      Engine.Run (Blob);
+   }
+
+   std::vector<double> Latencies;
+
+   for (int i = 0; i < std::max (1, Runs); ++i) {
+      auto Start = std::chrono::steady_clock::now ();
+
+      Engine.Run (Blob);
+
+      std::chrono::duration<double, std::milli> Elapsed = std::chrono::steady_clock::now () - Start;
+      Latencies.push_back (Elapsed.count ());
+   }
+
+   std::sort (Latencies.begin (), Latencies.end ());
+
+   auto Percentile = [ & ] (double P) {
+      size_t Index = (size_t) std::ceil (P * Latencies.size ()) - 1;
+      return Latencies [std::min (Index, Latencies.size () - 1)];
+   };
+
+   return { Percentile (0.50), Percentile (0.99) };
+}
\ No newline at end of file
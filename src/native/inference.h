@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <opencv2/core/mat.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Runs the tooltip detection model. Implementations are not thread safe, the
+// caller serializes Run calls.
+class InferenceEngine
+{
+   public:
+
+   virtual ~InferenceEngine () = default;
+
+   virtual std::string Name () const = 0;
+
+   virtual bool Load (const std::string& OnnxFile) = 0;
+
+   // Runs the model on a 1x3xHxW CV_32F blob and returns its first output. The
+   // returned matrix may point into engine owned memory and is only valid
+   // until the next call to Run.
+   virtual cv::Mat Run (const cv::Mat& Blob) = 0;
+};
+
+struct InferenceBenchmark
+{
+   double Median;
+   double P99;
+};
+
+// A reimplemented detector stage timed next to the OpenCV path it replaced.
+// Difference is how far its output is from that path's, latencies are in
+// milliseconds.
+struct StageBenchmark
+{
+   double Difference;
+   double Median;
+   double P99;
+
+   // Share of the model's boxes a detector found and of its boxes the model
+   // found too, for detectors that replace the model only.
+   std::optional<double> Recall;
+   std::optional<double> Precision;
+};
+
+// Names of the engines compiled into this build, OpenCV DNN is always first.
+std::vector<std::string> AvailableInferenceEngines ();
+
+// Returns nullptr for engines that are unknown or not compiled in.
+std::unique_ptr<InferenceEngine> CreateInferenceEngine (const std::string& Name);
+
+// Times Runs inferences of a Width x Height input on a loaded engine, after a
+// few untimed warm up runs. Latencies are in milliseconds.
+InferenceBenchmark BenchmarkInferenceEngine (InferenceEngine& Engine, int Width, int Height, int Runs);
\ No newline at end of file
@@ -1,7 +1,11 @@
 #include "async.cpp"
+#include "scanner.h"
 #include "screen.h"
+#include "stats.h"
+#include "trace.h"
 #include "util.h"
 #include "windows.h"
+#include <algorithm>
 #include <napi.h>
 #include <string>
 #include <mutex>
@@ -9,6 +13,20 @@
 std::shared_ptr<Screen> GlobalScreen = nullptr;
 std::mutex GlobalScreenMutex;
 
+// The continuous scanner and the JS callback it reports changes to, only
+// touched from the JS thread
+std::unique_ptr<Scanner> GlobalScanner = nullptr;
+Napi::ThreadSafeFunction GlobalScannerCallback;
+
+// Stops the scanner and lets go of its callback.
+void StopGlobalScanner ()
+{
+   if (GlobalScanner) {
+      GlobalScanner.reset ();
+      GlobalScannerCallback.Release ();
+   }
+}
+
 Napi::Value Initialize (const Napi::CallbackInfo& Info) 
 {
    Napi::Env Env = Info.Env ();
@@ -35,6 +53,10 @@ Napi::Value Initialize (const Napi::CallbackInfo& Info)
    std::string TesseractPath = Info [0].As<Napi::String> ().Utf8Value ();
    std::string OnnxFile = Info [1].As<Napi::String> ().Utf8Value ();
    
+   // A running scanner holds on to the previous screen and reads the
+   // settings below from its threads, stop it before they change.
+   StopGlobalScanner ();
+   
    {
       std::lock_guard<std::mutex> lock(GlobalScreenMutex);
       if (GlobalScreen) {
@@ -47,6 +69,87 @@ Napi::Value Initialize (const Napi::CallbackInfo& Info)
    Screen::TesseractPath = TesseractPath;
    Screen::OnnxFile = OnnxFile;
    
+   // Optional settings object after the log callback
+   if (Info.Length () > 3 && Info [3].IsObject ()) {
+      Napi::Object Options = Info [3].As<Napi::Object> ();
+      
+      if (Options.Get ("engine").IsString ()) {
+         Screen::EngineName = Options.Get ("engine").As<Napi::String> ().Utf8Value ();
+      }
+      
+      if (Options.Get ("quantized").IsBoolean ()) {
+         Screen::UseQuantizedModel = Options.Get ("quantized").As<Napi::Boolean> ().Value ();
+      }
+      
+      if (Options.Get ("inputSize").IsNumber ()) {
+         Screen::InputSize = Options.Get ("inputSize").As<Napi::Number> ().Int32Value ();
+      }
+      
+      if (Options.Get ("borderDetector").IsBoolean ()) {
+         Screen::UseBorderDetector = Options.Get ("borderDetector").As<Napi::Boolean> ().Value ();
+      }
+      
+      if (Options.Get ("lineSegmentation").IsBoolean ()) {
+         Screen::UseLineSegmentation = Options.Get ("lineSegmentation").As<Napi::Boolean> ().Value ();
+      }
+      
+      if (Options.Get ("glyphReader").IsBoolean ()) {
+         Screen::UseGlyphReader = Options.Get ("glyphReader").As<Napi::Boolean> ().Value ();
+      }
+      
+      if (Options.Get ("readCacheSize").IsNumber ()) {
+         double Megabytes = std::max (0.0, Options.Get ("readCacheSize").As<Napi::Number> ().DoubleValue ());
+         Screen::ReadCacheBytes = (size_t) (Megabytes * 1024 * 1024);
+      }
+      
+      if (Options.Get ("ocrXHeight").IsNumber ()) {
+         Screen::OcrXHeight = std::max (0, Options.Get ("ocrXHeight").As<Napi::Number> ().Int32Value ());
+      }
+      
+      if (Options.Get ("twoPhaseRead").IsBoolean ()) {
+         Screen::UseTwoPhaseRead = Options.Get ("twoPhaseRead").As<Napi::Boolean> ().Value ();
+      }
+      
+      // Trace events kept for dumpTrace, none records nothing
+      if (Options.Get ("traceEvents").IsNumber ()) {
+         Trace::configure ((size_t) std::max (0, Options.Get ("traceEvents").As<Napi::Number> ().Int32Value ()));
+      }
+      
+      // Names of the tooltip sections the overlay shows, as in SectionName
+      if (Options.Get ("sections").IsArray ()) {
+         Napi::Array Sections = Options.Get ("sections").As<Napi::Array> ();
+         
+         Screen::EnabledSections.fill (false);
+         Screen::EnabledSections [(int) Section::Header] = true;
+         
+         for (uint32_t i = 0; i < Sections.Length (); ++i) {
+            if (!Sections.Get (i).IsString ()) {
+               continue;
+            }
+            
+            std::string Name = Sections.Get (i).As<Napi::String> ().Utf8Value ();
+            
+            for (int Part = 0; Part < SECTION_COUNT; ++Part) {
+               if (Name == SectionName ((Section) Part)) {
+                  Screen::EnabledSections [Part] = true;
+               }
+            }
+         }
+      }
+      
+      if (Options.Get ("fonts").IsArray ()) {
+         Napi::Array Fonts = Options.Get ("fonts").As<Napi::Array> ();
+         
+         Screen::FontFiles.clear ();
+         
+         for (uint32_t i = 0; i < Fonts.Length (); ++i) {
+            if (Fonts.Get (i).IsString ()) {
+               Screen::FontFiles.push_back (Fonts.Get (i).As<Napi::String> ().Utf8Value ());
+            }
+         }
+      }
+   }
+   
    auto callback = Napi::ThreadSafeFunction::New (
       Env,
       Info [2].As<Napi::Function> (),
@@ -67,6 +170,79 @@ Napi::Value Initialize (const Napi::CallbackInfo& Info)
    return Napi::Boolean::New (Env, Result);
 }
 
+// Reads the optional { x, y, radius } cursor argument of getTooltip.
+std::optional<Screen::Cursor> ParseCursor (const Napi::CallbackInfo& Info)
+{
+   if (Info.Length () < 1 || !Info [0].IsObject ()) {
+      return std::nullopt;
+   }
+   
+   Napi::Object Options = Info [0].As<Napi::Object> ();
+   
+   Napi::Value X = Options.Get ("x");
+   Napi::Value Y = Options.Get ("y");
+   Napi::Value Radius = Options.Get ("radius");
+   
+   if (!X.IsNumber () || !Y.IsNumber () || !Radius.IsNumber ()) {
+      return std::nullopt;
+   }
+   
+   Screen::Cursor Position = {
+      X.As<Napi::Number> ().Int32Value (),
+      Y.As<Napi::Number> ().Int32Value (),
+      Radius.As<Napi::Number> ().Int32Value ()
+   };
+   
+   if (Position.Radius <= 0) {
+      return std::nullopt;
+   }
+   
+   return Position;
+}
+
+// Reads the optional [{ x, y, width, height }] second argument of getTooltip,
+// the tooltips the overlay currently draws in screenshot coordinates.
+std::vector<cv::Rect> ParseExclusions (const Napi::CallbackInfo& Info)
+{
+   std::vector<cv::Rect> Exclusions;
+   
+   if (Info.Length () < 2 || !Info [1].IsArray ()) {
+      return Exclusions;
+   }
+   
+   Napi::Array Rects = Info [1].As<Napi::Array> ();
+   
+   for (uint32_t i = 0; i < Rects.Length (); ++i) {
+      if (!Rects.Get (i).IsObject ()) {
+         continue;
+      }
+      
+      Napi::Object Rect = Rects.Get (i).As<Napi::Object> ();
+      
+      Napi::Value X = Rect.Get ("x");
+      Napi::Value Y = Rect.Get ("y");
+      Napi::Value Width = Rect.Get ("width");
+      Napi::Value Height = Rect.Get ("height");
+      
+      if (!X.IsNumber () || !Y.IsNumber () || !Width.IsNumber () || !Height.IsNumber ()) {
+         continue;
+      }
+      
+      cv::Rect Excluded (
+         X.As<Napi::Number> ().Int32Value (),
+         Y.As<Napi::Number> ().Int32Value (),
+         Width.As<Napi::Number> ().Int32Value (),
+         Height.As<Napi::Number> ().Int32Value ()
+      );
+      
+      if (!Excluded.empty ()) {
+         Exclusions.push_back (Excluded);
+      }
+   }
+   
+   return Exclusions;
+}
+
 Napi::Value GetTooltip (const Napi::CallbackInfo& Info) 
 {
    Napi::Env Env = Info.Env ();
@@ -83,7 +259,13 @@ Napi::Value GetTooltip (const Napi::CallbackInfo& Info)
          screen = GlobalScreen;
       }
       
-      auto* Worker = new TooltipWorker (Env, screen);
+      // The optional third argument is the correlation ID of the scan, its
+      // native stages are traced under it.
+      uint64_t TraceId = Info.Length () > 2 && Info [2].IsNumber ()
+         ? (uint64_t) std::max ((int64_t) 0, Info [2].As<Napi::Number> ().Int64Value ())
+         : 0;
+      
+      auto* Worker = new TooltipWorker (Env, screen, ParseCursor (Info), ParseExclusions (Info), TraceId);
       Worker->Queue ();
       
       return Worker->GetPromise ();
@@ -96,6 +278,137 @@ Napi::Value GetTooltip (const Napi::CallbackInfo& Info)
    }
 }
 
+// Starts scanning continuously, callback is called with a getTooltip like
+// result whenever the tooltip on screen changes and with null when it goes
+// away. The optional second argument is { interval } in milliseconds between
+// captures.
+Napi::Value StartScanner (const Napi::CallbackInfo& Info) 
+{
+   Napi::Env Env = Info.Env ();
+   
+   if (Info.Length () < 1 || !Info [0].IsFunction ()) {
+      Napi::TypeError::New (Env, "Expected a callback").ThrowAsJavaScriptException ();
+      return Env.Undefined ();
+   }
+   
+   std::shared_ptr<Screen> screen;
+   {
+      std::lock_guard<std::mutex> lock(GlobalScreenMutex);
+      if (!GlobalScreen) {
+         Napi::Error::New (Env, "Screen not initialized").ThrowAsJavaScriptException ();
+         return Env.Undefined ();
+      }
+      screen = GlobalScreen;
+   }
+   
+   int Interval = 50;
+   
+   if (Info.Length () > 1 && Info [1].IsObject ()) {
+      Napi::Object Options = Info [1].As<Napi::Object> ();
+      
+      if (Options.Get ("interval").IsNumber ()) {
+         Interval = Options.Get ("interval").As<Napi::Number> ().Int32Value ();
+      }
+   }
+   
+   StopGlobalScanner ();
+   
+   GlobalScannerCallback = Napi::ThreadSafeFunction::New (
+      Env,
+      Info [0].As<Napi::Function> (),
+      "ScannerCallback",
+      0,
+      1
+   );
+   
+   Napi::ThreadSafeFunction Callback = GlobalScannerCallback;
+   
+   auto OnChange = [ Callback ] (const std::optional<Screen::Reading>& Current) mutable {
+      Callback.NonBlockingCall ([ Current ] (Napi::Env Env, Napi::Function Callee) {
+         if (!Current) {
+            Callee.Call ({ Env.Null () });
+            return;
+         }
+         
+         Napi::Object Result = Napi::Object::New (Env);
+         
+         SetText (Result, Current->Text);
+         
+         Result.Set ("complete", Napi::Boolean::New (Env, true));
+         Result.Set ("x", Napi::Number::New (Env, Current->Tooltip.x));
+         Result.Set ("y", Napi::Number::New (Env, Current->Tooltip.y));
+         Result.Set ("width", Napi::Number::New (Env, Current->Tooltip.width));
+         Result.Set ("height", Napi::Number::New (Env, Current->Tooltip.height));
+         
+         Callee.Call ({ Result });
+      });
+   };
+   
+   GlobalScanner = std::make_unique<Scanner> (screen, OnChange, Interval);
+   GlobalScanner->Start ();
+   
+   return Env.Undefined ();
+}
+
+// Takes the same cursor and overlay arguments as getTooltip for the frames
+// the scanner captures from now on.
+Napi::Value UpdateScanner (const Napi::CallbackInfo& Info) 
+{
+   if (GlobalScanner) {
+      GlobalScanner->Aim (ParseCursor (Info), ParseExclusions (Info));
+   }
+   
+   return Info.Env ().Undefined ();
+}
+
+Napi::Value StopScanner (const Napi::CallbackInfo& Info) 
+{
+   StopGlobalScanner ();
+   return Info.Env ().Undefined ();
+}
+
+static Napi::Object DescribeStage (Napi::Env Env, const Scanner::Stage& Stage)
+{
+   Napi::Object Result = Napi::Object::New (Env);
+   
+   Result.Set ("frames", Napi::Number::New (Env, (double) Stage.Frames));
+   Result.Set ("perSecond", Napi::Number::New (Env, Stage.Rate));
+   Result.Set ("queueDepth", Napi::Number::New (Env, (double) Stage.Depth));
+   Result.Set ("peakQueueDepth", Napi::Number::New (Env, (double) Stage.PeakDepth));
+   
+   return Result;
+}
+
+// Throughput of every scanner stage and the depth of the queue in front of
+// it.
+Napi::Value GetScannerStats (const Napi::CallbackInfo& Info) 
+{
+   Napi::Env Env = Info.Env ();
+   
+   if (!GlobalScanner) {
+      return Env.Null ();
+   }
+   
+   Scanner::Status Status = GlobalScanner->Snapshot ();
+   
+   Napi::Object Stages = Napi::Object::New (Env);
+   
+   Stages.Set ("capture", DescribeStage (Env, Status.Capture));
+   Stages.Set ("detect", DescribeStage (Env, Status.Detect));
+   Stages.Set ("read", DescribeStage (Env, Status.Read));
+   
+   Napi::Object Result = Napi::Object::New (Env);
+   
+   Result.Set ("running", Napi::Boolean::New (Env, Status.Running));
+   Result.Set ("seconds", Napi::Number::New (Env, Status.Seconds));
+   Result.Set ("stages", Stages);
+   Result.Set ("changes", Napi::Number::New (Env, (double) Status.Changes));
+   Result.Set ("dropped", Napi::Number::New (Env, (double) Status.Dropped));
+   Result.Set ("queueCapacity", Napi::Number::New (Env, (double) Status.Capacity));
+   
+   return Result;
+}
+
 Napi::Value FetchActiveWindow (const Napi::CallbackInfo& Info) 
 {
    auto* Worker = new ActiveWindowWorker (Info.Env ());
@@ -110,11 +423,180 @@ Napi::Value FetchGameWindow (const Napi::CallbackInfo& Info)
    return Worker->GetPromise ();
 }
 
+Napi::Value BenchmarkInference (const Napi::CallbackInfo& Info) 
+{
+   Napi::Env Env = Info.Env ();
+   
+   std::shared_ptr<Screen> screen;
+   {
+      std::lock_guard<std::mutex> lock(GlobalScreenMutex);
+      if (!GlobalScreen) {
+         Napi::Error::New (Env, "Screen not initialized").ThrowAsJavaScriptException ();
+         return Env.Undefined ();
+      }
+      screen = GlobalScreen;
+   }
+   
+   int Runs = 50;
+   
+   if (Info.Length () > 0 && Info [0].IsNumber ()) {
+      Runs = Info [0].As<Napi::Number> ().Int32Value ();
+   }
+   
+   auto* Worker = new InferenceBenchmarkWorker (Env, screen, Runs);
+   Worker->Queue ();
+   
+   return Worker->GetPromise ();
+}
+
+// Compares the fused detector stages with the OpenCV ones they replaced, and
+// the border detector with the model. The optional arguments are the timed runs per frame and a directory of full
+// screenshots to use as frames.
+Napi::Value BenchmarkDetector (const Napi::CallbackInfo& Info) 
+{
+   Napi::Env Env = Info.Env ();
+   
+   std::shared_ptr<Screen> screen;
+   {
+      std::lock_guard<std::mutex> lock(GlobalScreenMutex);
+      if (!GlobalScreen) {
+         Napi::Error::New (Env, "Screen not initialized").ThrowAsJavaScriptException ();
+         return Env.Undefined ();
+      }
+      screen = GlobalScreen;
+   }
+   
+   int Runs = 20;
+   std::string Directory;
+   
+   if (Info.Length () > 0 && Info [0].IsNumber ()) {
+      Runs = Info [0].As<Napi::Number> ().Int32Value ();
+   }
+   
+   if (Info.Length () > 1 && Info [1].IsString ()) {
+      Directory = Info [1].As<Napi::String> ().Utf8Value ();
+   }
+   
+   auto* Worker = new DetectorBenchmarkWorker (Env, screen, Runs, Directory);
+   Worker->Queue ();
+   
+   return Worker->GetPromise ();
+}
+
+Napi::Value BenchmarkOcr (const Napi::CallbackInfo& Info) 
+{
+   Napi::Env Env = Info.Env ();
+   
+   if (Info.Length () < 1 || !Info [0].IsString ()) {
+      Napi::TypeError::New (Env, "Expected a directory of tooltip crops").ThrowAsJavaScriptException ();
+      return Env.Undefined ();
+   }
+   
+   std::shared_ptr<Screen> screen;
+   {
+      std::lock_guard<std::mutex> lock(GlobalScreenMutex);
+      if (!GlobalScreen) {
+         Napi::Error::New (Env, "Screen not initialized").ThrowAsJavaScriptException ();
+         return Env.Undefined ();
+      }
+      screen = GlobalScreen;
+   }
+   
+   auto* Worker = new ReadBenchmarkWorker (Env, screen, Info [0].As<Napi::String> ().Utf8Value ());
+   Worker->Queue ();
+   
+   return Worker->GetPromise ();
+}
+
+Napi::Value GetStats (const Napi::CallbackInfo& Info) 
+{
+   return Stats::snapshot (Info.Env ());
+}
+
+Napi::Value ResetStats (const Napi::CallbackInfo& Info) 
+{
+   Stats::reset ();
+   
+   return Info.Env ().Undefined ();
+}
+
+// Records a timing measured in JS, such as the time to the first price, next
+// to the native ones.
+Napi::Value RecordTime (const Napi::CallbackInfo& Info) 
+{
+   Napi::Env Env = Info.Env ();
+   
+   if (Info.Length () < 2 || !Info [0].IsString () || !Info [1].IsNumber ()) {
+      Napi::TypeError::New (Env, "Expected a timing name and milliseconds").ThrowAsJavaScriptException ();
+      return Env.Undefined ();
+   }
+   
+   Stats::time (Info [0].As<Napi::String> ().Utf8Value (), Info [1].As<Napi::Number> ().DoubleValue ());
+   
+   return Env.Undefined ();
+}
+
+// Microseconds on the clock trace events are recorded with, JS converts its
+// own timestamps with it.
+Napi::Value TraceClock (const Napi::CallbackInfo& Info) 
+{
+   return Napi::Number::New (Info.Env (), (double) Trace::now ());
+}
+
+// Records a trace event measured in JS, an object with name, category, scan,
+// start and duration in microseconds on the trace clock, pid and tid.
+Napi::Value RecordTrace (const Napi::CallbackInfo& Info) 
+{
+   Napi::Env Env = Info.Env ();
+   
+   if (Info.Length () < 1 || !Info [0].IsObject ()) {
+      Napi::TypeError::New (Env, "Expected a trace event").ThrowAsJavaScriptException ();
+      return Env.Undefined ();
+   }
+   
+   if (!Trace::enabled ()) {
+      return Env.Undefined ();
+   }
+   
+   Napi::Object Event = Info [0].As<Napi::Object> ();
+   
+   auto Number = [ & ] (const char* Key) -> int64_t {
+      Napi::Value Value = Event.Get (Key);
+      return Value.IsNumber () ? Value.As<Napi::Number> ().Int64Value () : 0;
+   };
+   
+   auto Text = [ & ] (const char* Key, const char* Fallback) -> std::string {
+      Napi::Value Value = Event.Get (Key);
+      return Value.IsString () ? Value.As<Napi::String> ().Utf8Value () : Fallback;
+   };
+   
+   Trace::record ({
+      Text ("name", "unnamed"),
+      Text ("category", "js"),
+      Number ("start"),
+      std::max ((int64_t) 0, Number ("duration")),
+      (uint64_t) std::max ((int64_t) 0, Number ("scan")),
+      Number ("pid"),
+      Number ("tid")
+   });
+   
+   return Env.Undefined ();
+}
+
+// The buffered trace events as a Chrome Trace Event JSON document.
+Napi::Value DumpTrace (const Napi::CallbackInfo& Info) 
+{
+   return Napi::String::New (Info.Env (), Trace::dump ());
+}
+
 Napi::Value Cleanup (const Napi::CallbackInfo& Info) 
 {
    Napi::Env Env = Info.Env ();
    
    try {
+      // The scanner holds on to the screen, stop it first.
+      StopGlobalScanner ();
+      
       std::lock_guard<std::mutex> lock(GlobalScreenMutex);
       if (GlobalScreen) {
          GlobalScreen.reset ();
@@ -130,8 +612,21 @@ Napi::Object Init (Napi::Env Env, Napi::Object Exports)
 {
    Exports.Set ("initialize", Napi::Function::New (Env, Initialize));
    Exports.Set ("getTooltip", Napi::Function::New (Env, GetTooltip));
+   Exports.Set ("startScanner", Napi::Function::New (Env, StartScanner));
+   Exports.Set ("updateScanner", Napi::Function::New (Env, UpdateScanner));
+   Exports.Set ("stopScanner", Napi::Function::New (Env, StopScanner));
+   Exports.Set ("getScannerStats", Napi::Function::New (Env, GetScannerStats));
    Exports.Set ("getActiveWindow", Napi::Function::New (Env, FetchActiveWindow));
    Exports.Set ("getGameWindow", Napi::Function::New (Env, FetchGameWindow));
+   Exports.Set ("getStats", Napi::Function::New (Env, GetStats));
+   Exports.Set ("resetStats", Napi::Function::New (Env, ResetStats));
+   Exports.Set ("recordTime", Napi::Function::New (Env, RecordTime));
+   Exports.Set ("traceClock", Napi::Function::New (Env, TraceClock));
+   Exports.Set ("recordTrace", Napi::Function::New (Env, RecordTrace));
+   Exports.Set ("dumpTrace", Napi::Function::New (Env, DumpTrace));
+   Exports.Set ("benchmarkInference", Napi::Function::New (Env, BenchmarkInference));
+   Exports.Set ("benchmarkDetector", Napi::Function::New (Env, BenchmarkDetector));
+   Exports.Set ("benchmarkOcr", Napi::Function::New (Env, BenchmarkOcr));
    Exports.Set ("cleanup", Napi::Function::New (Env, Cleanup));
    
    return Exports;
@@ -0,0 +1,549 @@
+#include "logger.h"
+#include "ocr.h"
+#include "pool.h"
+#include "stats.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <stdexcept>
+#include <tesseract/ocrclass.h>
+
+namespace {
+
+// Pixels darker than this are text once binarized.
+const int INK_LEVEL = 128;
+
+// Columns with ink in this share of all rows are frame edges, not text.
+const double FRAME_COLUMN_RATIO = 0.9;
+
+// Rows need at least this many ink pixels to belong to a line.
+const int MINIMUM_ROW_INK = 2;
+
+// Gaps up to this many rows are inside a line, between accents and letters.
+const int MAXIMUM_LINE_GAP = 1;
+
+// Shorter strips are separators or noise.
+const int MINIMUM_LINE_HEIGHT = 6;
+
+// Strips that are ink across this share of their area are separators.
+const double SEPARATOR_INK_RATIO = 0.6;
+
+const int LINE_PADDING = 3;
+
+// Sections are split where the gap between two lines is wider than the usual
+// line spacing by this share of a line's height.
+const double SECTION_GAP_RATIO = 0.5;
+
+// Rows with this share of a line's densest row are inside its x-height.
+const double X_HEIGHT_INK_RATIO = 0.4;
+
+// The x-height of a 10 point font is about 5 points, so at a resolution of
+// DPI it is DPI * 5 / 72 pixels.
+const double DPI_PER_X_HEIGHT_PIXEL = 72.0 / 5.0;
+
+// Tesseract ignores resolutions outside of this range.
+const int MINIMUM_DPI = 70;
+const int MAXIMUM_DPI = 2400;
+
+// Text within this share of the target x-height is read at its native size.
+const double SCALE_TOLERANCE = 0.1;
+
+const double MINIMUM_SCALE = 0.25;
+const double MAXIMUM_SCALE = 4.0;
+
+// Ink mask of a binarized tooltip without the frame edges left over after
+// trimming its border, they have ink in every row and would join all lines
+// into one.
+cv::Mat TextInk (const cv::Mat& Binary)
+{
+   cv::Mat Ink;
+   cv::compare (Binary, INK_LEVEL, Ink, cv::CMP_LT);
+   
+   cv::Mat ColumnInk;
+   cv::reduce (Ink, ColumnInk, 0, cv::REDUCE_SUM, CV_32S);
+   
+   for (int x = 0; x < Ink.cols; ++x) {
+      if (ColumnInk.at<int> (x) / 255 >= FRAME_COLUMN_RATIO * Ink.rows) {
+         Ink.col (x).setTo (0);
+      }
+   }
+   
+   return Ink;
+}
+
+// Text lines and the middle rows of the horizontal rules between them.
+struct Strips
+{
+   std::vector<cv::Range> Lines;
+   std::vector<int> Separators;
+};
+
+Strips FindStrips (const cv::Mat& Binary)
+{
+   Strips Found;
+   
+   if (Binary.empty ()) {
+      return Found;
+   }
+   
+   cv::Mat Ink = TextInk (Binary);
+   
+   cv::Mat RowInk;
+   cv::reduce (Ink, RowInk, 1, cv::REDUCE_SUM, CV_32S);
+   
+   auto Close = [ & ] (int Start, int End) {
+      double Total = cv::sum (RowInk.rowRange (Start, End)) [0] / 255;
+      
+      if (Total >= SEPARATOR_INK_RATIO * (End - Start) * Ink.cols) {
+         Found.Separators.push_back ((Start + End) / 2);
+         return;
+      }
+      
+      if (End - Start < MINIMUM_LINE_HEIGHT) {
+         return;
+      }
+      
+      Found.Lines.emplace_back (
+         std::max (Start - LINE_PADDING, 0),
+         std::min (End + LINE_PADDING, Ink.rows)
+      );
+   };
+   
+   int Start = -1;
+   int Last = -1;
+   
+   for (int y = 0; y < Ink.rows; ++y) {
+      if (RowInk.at<int> (y) / 255 >= MINIMUM_ROW_INK) {
+         if (Start < 0) {
+            Start = y;
+         }
+         
+         Last = y;
+      } else if (Start >= 0 && y - Last > MAXIMUM_LINE_GAP) {
+         Close (Start, Last + 1);
+         Start = -1;
+      }
+   }
+   
+   if (Start >= 0) {
+      Close (Start, Last + 1);
+   }
+   
+   return Found;
+}
+
+int Median (std::vector<int> Values)
+{
+   std::nth_element (Values.begin (), Values.begin () + Values.size () / 2, Values.end ());
+   return Values [Values.size () / 2];
+}
+
+}
+
+void TesseractPool::Releaser::operator() (tesseract::TessBaseAPI* Api) const
+{
+   Pool->Release (Api);
+}
+
+TesseractPool::~TesseractPool ()
+{
+   Clear ();
+}
+
+bool TesseractPool::Initialize (const std::string& DataPath, int Size)
+{
+   Clear ();
+
+   std::lock_guard<std::mutex> Guard (Lock);
+
+   for (int i = 0; i < std::max (Size, 1); ++i) {
+      auto Api = std::make_unique<tesseract::TessBaseAPI> ();
+
+      if (Api->Init (DataPath.c_str (), "eng", tesseract::OEM_LSTM_ONLY) != 0) {
+         Logger::log (
+            Logger::Level::E_ERROR,
+            "Failed to initialize tesseract using datapath: " + DataPath
+         );
+
+         for (auto& Instance : Instances) {
+            Instance->End ();
+         }
+
+         Instances.clear ();
+         Idle.clear ();
+
+         return false;
+      }
+
+      Api->SetPageSegMode (tesseract::PSM_SINGLE_BLOCK);
+      Api->SetVariable ("debug_file", "/dev/null");
+      Api->SetVariable ("user_defined_dpi", std::to_string (DEFAULT_DPI).c_str ());
+
+      Idle.push_back (Api.get ());
+      Instances.push_back (std::move (Api));
+   }
+
+   return true;
+}
+
+TesseractPool::Lease TesseractPool::Acquire ()
+{
+   std::unique_lock<std::mutex> Guard (Lock);
+
+   if (Instances.empty ()) {
+      throw std::runtime_error ("Tesseract pool is not initialized");
+   }
+
+   Stats::count ("ocr.pool.leases");
+
+   if (Idle.empty ()) {
+      Stats::count ("ocr.pool.contended");
+   }
+
+   auto Start = std::chrono::steady_clock::now ();
+
+   Returned.wait (Guard, [ this ] () {
+      return !Idle.empty ();
+   });
+
+   std::chrono::duration<double, std::milli> Waited = std::chrono::steady_clock::now () - Start;
+   Stats::time ("ocr.pool.wait", Waited.count ());
+
+   tesseract::TessBaseAPI* Api = Idle.back ();
+   Idle.pop_back ();
+
+   return Lease (Api, Releaser { this });
+}
+
+void TesseractPool::Release (tesseract::TessBaseAPI* Api)
+{
+   {
+      std::lock_guard<std::mutex> Guard (Lock);
+      Idle.push_back (Api);
+   }
+
+   Returned.notify_all ();
+}
+
+void TesseractPool::Clear ()
+{
+   std::unique_lock<std::mutex> Guard (Lock);
+
+   Returned.wait (Guard, [ this ] () {
+      return Idle.size () == Instances.size ();
+   });
+
+   for (auto& Instance : Instances) {
+      Instance->End ();
+   }
+
+   Instances.clear ();
+   Idle.clear ();
+}
+
+int TesseractPool::Size ()
+{
+   std::lock_guard<std::mutex> Guard (Lock);
+   return (int) Instances.size ();
+}
+
+std::string RecognizeText (
+   tesseract::TessBaseAPI& Tesseract,
+   const cv::Mat& Binary,
+   tesseract::PageSegMode Mode,
+   const std::function<bool ()>& Cancelled,
+   const TextScale& Scale
+)
+{
+   cv::Mat Scaled = Binary;
+   
+   if (Scale.Factor != 1.0) {
+      cv::Size Size (cvRound (Binary.cols * Scale.Factor), cvRound (Binary.rows * Scale.Factor));
+      
+      // On a work pool thread the resampled copy comes from its scratch
+      // arena, it is only needed until Tesseract has read it.
+      if (ScratchArena* Arena = WorkPool::Arena ()) {
+         Scaled = cv::Mat (Size, CV_8UC1, Arena->Allocate ((size_t) Size.area ()));
+      }
+      
+      cv::resize (Binary, Scaled, Size, 0, 0, Scale.Factor < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR);
+      cv::threshold (Scaled, Scaled, INK_LEVEL - 1, 255, cv::THRESH_BINARY);
+   }
+   
+   Tesseract.SetPageSegMode (Mode);
+   
+   // The instance is leased to this read alone, so the resolution can be
+   // changed for it.
+   Tesseract.SetVariable ("user_defined_dpi", std::to_string (Scale.Dpi).c_str ());
+   
+   Tesseract.SetImage (
+      Scaled.data, 
+      Scaled.cols, 
+      Scaled.rows,
+      Scaled.channels (), 
+      (int) Scaled.step
+   );
+   
+   // Tesseract polls the monitor between words, a cancelled read stops there.
+   ETEXT_DESC Monitor;
+   
+   if (Cancelled) {
+      Monitor.cancel = [] (void* Context, int) -> bool {
+         return (*static_cast<const std::function<bool ()>*> (Context)) ();
+      };
+      
+      Monitor.cancel_this = const_cast<std::function<bool ()>*> (&Cancelled);
+   }
+   
+   {
+      Stats::Timer Timer ("ocr.recognize");
+      Tesseract.Recognize (&Monitor);
+   }
+   
+   if (Cancelled && Cancelled ()) {
+      Tesseract.Clear ();
+      return std::string ();
+   }
+   
+   std::unique_ptr<char[]> Text (Tesseract.GetUTF8Text ());
+   
+   if (!Text) {
+      Logger::log (
+         Logger::Level::E_ERROR,
+         "Failed to extract text from image with Tesseract"
+      );
+      
+      return std::string ();
+   }
+   
+   return std::string (Text.get ());
+}
+
+std::vector<cv::Range> SegmentLines (const cv::Mat& Binary)
+{
+   return FindStrips (Binary).Lines;
+}
+
+const char* SectionName (Section Part)
+{
+   switch (Part) {
+      case Section::Header: return "header";
+      case Section::Primary: return "primary";
+      case Section::Secondary: return "secondary";
+      case Section::Details: return "details";
+   }
+   
+   return "";
+}
+
+std::string JoinSections (const SectionTexts& Texts)
+{
+   std::string Text;
+   
+   for (const std::string& Part : Texts) {
+      Text += Part;
+   }
+   
+   return Text;
+}
+
+void TooltipText::Merge (const TooltipText& Other)
+{
+   for (int i = 0; i < SECTION_COUNT; ++i) {
+      if (Other.Read [i]) {
+         Sections [i] = Other.Sections [i];
+         Read [i] = true;
+      }
+   }
+}
+
+bool TooltipText::Covers (const SectionSet& Parts) const
+{
+   for (int i = 0; i < SECTION_COUNT; ++i) {
+      if (Parts [i] && !Read [i]) {
+         return false;
+      }
+   }
+   
+   return true;
+}
+
+std::vector<SectionLayout> SegmentSections (const cv::Mat& Binary)
+{
+   Strips Found = FindStrips (Binary);
+   std::vector<SectionLayout> Sections;
+   
+   if (Found.Lines.empty ()) {
+      return Sections;
+   }
+   
+   // Padding is added to every line alike, it cancels out of the comparison
+   // between gaps.
+   std::vector<int> Gaps;
+   std::vector<int> Heights;
+   
+   for (size_t i = 0; i < Found.Lines.size (); ++i) {
+      Heights.push_back (std::max (Found.Lines [i].size () - 2 * LINE_PADDING, 1));
+      
+      if (i > 0) {
+         Gaps.push_back (Found.Lines [i].start - Found.Lines [i - 1].end);
+      }
+   }
+   
+   int Spacing = Gaps.empty () ? 0 : Median (Gaps);
+   int Height = Median (Heights);
+   
+   auto Splits = [ & ] (size_t i) {
+      const cv::Range& Above = Found.Lines [i - 1];
+      const cv::Range& Below = Found.Lines [i];
+      
+      for (int Separator : Found.Separators) {
+         if (Separator >= Above.end - LINE_PADDING && Separator < Below.start + LINE_PADDING) {
+            return true;
+         }
+      }
+      
+      return Below.start - Above.end > Spacing + SECTION_GAP_RATIO * Height;
+   };
+   
+   Sections.push_back ({ Section::Header, { Found.Lines [0] } });
+   
+   for (size_t i = 1; i < Found.Lines.size (); ++i) {
+      if (Splits (i) && Sections.back ().Part != Section::Details) {
+         Sections.push_back ({ (Section) ((int) Sections.back ().Part + 1), {} });
+      }
+      
+      Sections.back ().Lines.push_back (Found.Lines [i]);
+   }
+   
+   return Sections;
+}
+
+int MeasureXHeight (const cv::Mat& Binary)
+{
+   std::vector<cv::Range> Lines = SegmentLines (Binary);
+   
+   if (Lines.empty ()) {
+      return 0;
+   }
+   
+   cv::Mat Ink = TextInk (Binary);
+   std::vector<int> Heights;
+   
+   for (const cv::Range& Line : Lines) {
+      cv::Mat RowInk;
+      cv::reduce (Ink.rowRange (Line), RowInk, 1, cv::REDUCE_SUM, CV_32S);
+      
+      double Peak = 0;
+      cv::minMaxLoc (RowInk, nullptr, &Peak);
+      
+      if (Peak <= 0) {
+         continue;
+      }
+      
+      // Ascenders, descenders and accents add sparse rows above and below the
+      // dense band of lower case letters.
+      int Height = cv::countNonZero (RowInk >= X_HEIGHT_INK_RATIO * Peak);
+      
+      if (Height >= MINIMUM_LINE_HEIGHT / 2) {
+         Heights.push_back (Height);
+      }
+   }
+   
+   if (Heights.empty ()) {
+      return 0;
+   }
+   
+   // Lines of only capitals and digits measure their cap height instead,
+   // most tooltip lines have lower case letters.
+   return Median (Heights);
+}
+
+TextScale FitXHeight (const cv::Mat& Binary, int TargetXHeight)
+{
+   TextScale Scale;
+   
+   if (TargetXHeight <= 0) {
+      return Scale;
+   }
+   
+   int XHeight = MeasureXHeight (Binary);
+   
+   if (XHeight <= 0) {
+      return Scale;
+   }
+   
+   double Factor = std::clamp ((double) TargetXHeight / XHeight, MINIMUM_SCALE, MAXIMUM_SCALE);
+   
+   if (std::abs (Factor - 1.0) > SCALE_TOLERANCE) {
+      Scale.Factor = Factor;
+   }
+   
+   Scale.Dpi = std::clamp ((int) std::lround (XHeight * Scale.Factor * DPI_PER_X_HEIGHT_PIXEL), MINIMUM_DPI, MAXIMUM_DPI);
+   
+   return Scale;
+}
+
+std::string NormalizeText (const std::string& Text)
+{
+   std::string Normalized;
+   std::string Line;
+   
+   auto Flush = [ & ] () {
+      if (!Line.empty ()) {
+         Normalized += Normalized.empty () ? Line : "\n" + Line;
+      }
+      
+      Line.clear ();
+   };
+   
+   bool Space = false;
+   
+   for (char Character : Text) {
+      if (Character == '\n') {
+         Flush ();
+         Space = false;
+      } else if (Character == ' ' || Character == '\t' || Character == '\r') {
+         Space = !Line.empty ();
+      } else {
+         if (Space) {
+            Line += ' ';
+            Space = false;
+         }
+         
+         Line += Character;
+      }
+   }
+   
+   Flush ();
+   
+   return Normalized;
+}
+
+size_t EditDistance (const std::string& A, const std::string& B)
+{
+   std::vector<size_t> Previous (B.size () + 1);
+   std::vector<size_t> Current (B.size () + 1);
+   
+   for (size_t j = 0; j <= B.size (); ++j) {
+      Previous [j] = j;
+   }
+   
+   for (size_t i = 1; i <= A.size (); ++i) {
+      Current [0] = i;
+      
+      for (size_t j = 1; j <= B.size (); ++j) {
+         Current [j] = std::min ({
+            Previous [j] + 1,
+            Current [j - 1] + 1,
+            Previous [j - 1] + (A [i - 1] != B [j - 1])
+         });
+      }
+      
+      std::swap (Previous, Current);
+   }
+   
+   return Previous [B.size ()];
+}
\ No newline at end of file
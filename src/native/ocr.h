@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <opencv2/core/mat.hpp>
+#include <string>
+#include <tesseract/baseapi.h>
+#include <vector>
+
+// Initialized Tesseract instances that are leased out one caller at a time,
+// so several regions can be read at once.
+class TesseractPool
+{
+   public:
+
+   struct Releaser
+   {
+      TesseractPool* Pool;
+
+      void operator() (tesseract::TessBaseAPI* Api) const;
+   };
+
+   // Returns the instance to the pool when it goes out of scope.
+   using Lease = std::unique_ptr<tesseract::TessBaseAPI, Releaser>;
+
+   ~TesseractPool ();
+
+   // Creates Size instances configured for tooltip text, Size is clamped to
+   // at least one. Returns false when any of them fails to load.
+   bool Initialize (const std::string& DataPath, int Size);
+
+   // Waits until an instance is free. The wait is timed as ocr.pool.wait and
+   // leases that had to wait are counted as ocr.pool.contended.
+   Lease Acquire ();
+
+   // Waits for every lease to be returned and ends all instances.
+   void Clear ();
+
+   int Size ();
+
+   private:
+
+   std::mutex Lock;
+   std::condition_variable Returned;
+
+   std::vector<std::unique_ptr<tesseract::TessBaseAPI>> Instances;
+   std::vector<tesseract::TessBaseAPI*> Idle;
+
+   void Release (tesseract::TessBaseAPI* Api);
+};
+
+// Resolution Tesseract assumes for tooltips read at their native size.
+const int DEFAULT_DPI = 70;
+
+// How much to resample a binarized tooltip so Tesseract sees its text at a
+// chosen x-height, and the resolution to tell Tesseract afterwards.
+struct TextScale
+{
+   double Factor = 1.0;
+   int Dpi = DEFAULT_DPI;
+};
+
+// Recognizes a binarized image with dark text on a light background after
+// resampling it by Scale. Cancelled is polled between words, a cancelled read
+// returns an empty string.
+std::string RecognizeText (
+   tesseract::TessBaseAPI& Tesseract,
+   const cv::Mat& Binary,
+   tesseract::PageSegMode Mode,
+   const std::function<bool ()>& Cancelled,
+   const TextScale& Scale = TextScale ()
+);
+
+// Splits a binarized tooltip into text line strips using its horizontal
+// projection profile. Separators and the vertical frame edges are ignored.
+// The strips are ordered from top to bottom and padded with a few rows.
+std::vector<cv::Range> SegmentLines (const cv::Mat& Binary);
+
+// The visual sections of a tooltip from top to bottom: the item name and
+// rarity, its base stats, its rolled stats and everything below them.
+enum class Section {
+   Header,
+   Primary,
+   Secondary,
+   Details
+};
+
+const int SECTION_COUNT = 4;
+
+// Text read from every section, indexed by Section. Sections that were not
+// read are empty.
+typedef std::array<std::string, SECTION_COUNT> SectionTexts;
+
+// Which sections, indexed by Section.
+typedef std::array<bool, SECTION_COUNT> SectionSet;
+
+// The text of a tooltip by section and which sections it was read from.
+struct TooltipText
+{
+   SectionTexts Sections;
+   SectionSet Read = {};
+
+   // Takes over the sections Other read.
+   void Merge (const TooltipText& Other);
+
+   // Whether every section in Parts was read.
+   bool Covers (const SectionSet& Parts) const;
+};
+
+// Name of the section in the overlay's components setting.
+const char* SectionName (Section Part);
+
+// The text of all sections top to bottom.
+std::string JoinSections (const SectionTexts& Texts);
+
+struct SectionLayout
+{
+   Section Part;
+   std::vector<cv::Range> Lines;
+};
+
+// Splits a binarized tooltip into its sections, found at the horizontal
+// rules between them or at gaps clearly wider than the line spacing. Lines
+// are as returned by SegmentLines. A tooltip without either is a single
+// header section and anything after the fourth section is details.
+std::vector<SectionLayout> SegmentSections (const cv::Mat& Binary);
+
+// Returns the median x-height in pixels of the text lines of a binarized
+// tooltip, or 0 when it has none. The x-height of a line is the band of rows
+// where most of its ink is, between the baseline and the top of lower case
+// letters.
+int MeasureXHeight (const cv::Mat& Binary);
+
+// Returns the scale that brings the text of a binarized tooltip to
+// TargetXHeight pixels, with the resolution that makes a 10 point font have
+// that x-height. Text that cannot be measured, is already close to the target
+// or a TargetXHeight of 0 keep the native size.
+TextScale FitXHeight (const cv::Mat& Binary, int TargetXHeight);
+
+struct ReadBenchmark
+{
+   double ErrorRate;
+   double Median;
+   double P99;
+};
+
+// Drops blank lines and collapses runs of spaces so texts read in different
+// modes can be compared.
+std::string NormalizeText (const std::string& Text);
+
+// Levenshtein distance in bytes.
+size_t EditDistance (const std::string& A, const std::string& B);
\ No newline at end of file
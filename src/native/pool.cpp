@@ -0,0 +1,264 @@
+#include "pool.h"
+#include <algorithm>
+#include <exception>
+
+namespace
+{
+   // The pool and worker of the calling thread, set on pool threads only.
+   thread_local WorkPool* CurrentPool = nullptr;
+   thread_local size_t CurrentWorker = 0;
+   thread_local ScratchArena* CurrentArena = nullptr;
+}
+
+void* ScratchArena::Allocate (size_t Bytes, size_t Alignment)
+{
+   if (!Blocks.empty ()) {
+      Block& Last = Blocks.back ();
+
+      uintptr_t Base = (uintptr_t) Last.Memory.get ();
+      size_t Start = ((Base + Offset + Alignment - 1) & ~(uintptr_t) (Alignment - 1)) - Base;
+
+      if (Start + Bytes <= Last.Size) {
+         Offset = Start + Bytes;
+         return Last.Memory.get () + Start;
+      }
+   }
+
+   size_t Size = std::max (BLOCK_BYTES, Bytes + Alignment);
+
+   Blocks.push_back ({ std::make_unique<uint8_t[]> (Size), Size });
+   Offset = 0;
+
+   return Allocate (Bytes, Alignment);
+}
+
+void ScratchArena::Reset ()
+{
+   if (Blocks.size () > 1) {
+      auto Largest = std::max_element (Blocks.begin (), Blocks.end (), [] (const Block& A, const Block& B) {
+         return A.Size < B.Size;
+      });
+
+      Block Kept = std::move (*Largest);
+
+      Blocks.clear ();
+      Blocks.push_back (std::move (Kept));
+   }
+
+   Offset = 0;
+}
+
+WorkPool::WorkPool (int Size, Hooks ThreadHooks) : ThreadHooks (std::move (ThreadHooks))
+{
+   Size = std::max (Size, 1);
+
+   for (int i = 0; i < Size; ++i) {
+      Workers.push_back (std::make_unique<Worker> ());
+   }
+
+   for (int i = 0; i < Size; ++i) {
+      Threads.emplace_back (&WorkPool::Run, this, (size_t) i);
+   }
+}
+
+WorkPool::~WorkPool ()
+{
+   {
+      std::lock_guard<std::mutex> Guard (IdleLock);
+      Stopping = true;
+   }
+
+   Wake.notify_all ();
+
+   for (std::thread& Thread : Threads) {
+      Thread.join ();
+   }
+}
+
+void WorkPool::Submit (Task Work)
+{
+   size_t Index = CurrentPool == this
+      ? CurrentWorker
+      : NextWorker.fetch_add (1) % Workers.size ();
+
+   {
+      std::lock_guard<std::mutex> Guard (Workers [Index]->Lock);
+      Workers [Index]->Tasks.push_back (std::move (Work));
+   }
+
+   {
+      std::lock_guard<std::mutex> Guard (IdleLock);
+      Pending += 1;
+   }
+
+   Wake.notify_one ();
+}
+
+void WorkPool::ParallelFor (int Begin, int End, const std::function<void (int)>& Body)
+{
+   if (End <= Begin) {
+      return;
+   }
+
+   // Shared with the helper tasks, which may only start once the loop has
+   // returned. Body is only touched for an index that was claimed, and no
+   // index is left to claim by then.
+   struct Loop
+   {
+      const std::function<void (int)>* Body;
+      int End;
+
+      std::atomic<int> Next;
+      std::atomic<int> Remaining;
+
+      std::mutex Lock;
+      std::condition_variable Done;
+      std::exception_ptr Failure;
+   };
+
+   auto State = std::make_shared<Loop> ();
+
+   State->Body = &Body;
+   State->End = End;
+   State->Next = Begin;
+   State->Remaining = End - Begin;
+
+   auto Drain = [] (Loop& State) {
+      for (int i = State.Next++; i < State.End; i = State.Next++) {
+         try {
+            (*State.Body) (i);
+         } catch (...) {
+            std::lock_guard<std::mutex> Guard (State.Lock);
+
+            if (!State.Failure) {
+               State.Failure = std::current_exception ();
+            }
+         }
+
+         if (--State.Remaining == 0) {
+            std::lock_guard<std::mutex> Guard (State.Lock);
+            State.Done.notify_all ();
+         }
+      }
+   };
+
+   int Helpers = std::min (End - Begin, (int) Workers.size ()) - 1;
+
+   for (int i = 0; i < Helpers; ++i) {
+      Submit ([ State, Drain ] () {
+         Drain (*State);
+      });
+   }
+
+   // The caller works through the indices as well, so the loop finishes
+   // even when every pool thread is busy.
+   Drain (*State);
+
+   std::unique_lock<std::mutex> Guard (State->Lock);
+
+   State->Done.wait (Guard, [ & ] () {
+      return State->Remaining.load () == 0;
+   });
+
+   if (State->Failure) {
+      std::rethrow_exception (State->Failure);
+   }
+}
+
+int WorkPool::Size () const
+{
+   return (int) Workers.size ();
+}
+
+WorkPool::Counters WorkPool::Snapshot () const
+{
+   return {
+      Executed.load (),
+      Stolen.load (),
+      Pending.load ()
+   };
+}
+
+ScratchArena* WorkPool::Arena ()
+{
+   return CurrentArena;
+}
+
+void WorkPool::Run (size_t Index)
+{
+   CurrentPool = this;
+   CurrentWorker = Index;
+   CurrentArena = &Workers [Index]->Scratch;
+
+   if (ThreadHooks.Start) {
+      ThreadHooks.Start ();
+   }
+
+   while (true) {
+      Task Work;
+
+      if (Take (Index, Work)) {
+         try {
+            Work ();
+         } catch (...) {
+         }
+
+         Executed += 1;
+         CurrentArena->Reset ();
+
+         continue;
+      }
+
+      std::unique_lock<std::mutex> Guard (IdleLock);
+
+      Wake.wait (Guard, [ this ] () {
+         return Stopping || Pending.load () > 0;
+      });
+
+      if (Stopping && Pending.load () == 0) {
+         break;
+      }
+   }
+
+   if (ThreadHooks.Stop) {
+      ThreadHooks.Stop ();
+   }
+
+   CurrentPool = nullptr;
+   CurrentArena = nullptr;
+}
+
+bool WorkPool::Take (size_t Index, Task& Work)
+{
+   // The newest task of its own queue first, its data is most likely still
+   // in cache.
+   {
+      Worker& Own = *Workers [Index];
+      std::lock_guard<std::mutex> Guard (Own.Lock);
+
+      if (!Own.Tasks.empty ()) {
+         Work = std::move (Own.Tasks.back ());
+         Own.Tasks.pop_back ();
+         Pending -= 1;
+
+         return true;
+      }
+   }
+
+   // Then the oldest of another thread's.
+   for (size_t Offset = 1; Offset < Workers.size (); ++Offset) {
+      Worker& Victim = *Workers [(Index + Offset) % Workers.size ()];
+      std::lock_guard<std::mutex> Guard (Victim.Lock);
+
+      if (!Victim.Tasks.empty ()) {
+         Work = std::move (Victim.Tasks.front ());
+         Victim.Tasks.pop_front ();
+         Pending -= 1;
+         Stolen += 1;
+
+         return true;
+      }
+   }
+
+   return false;
+}
\ No newline at end of file
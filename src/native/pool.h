@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Bump allocator for memory that only lives as long as a task. Allocations
+// are never freed one by one, Reset releases all of them at once and keeps
+// the largest block for the next task.
+class ScratchArena
+{
+   public:
+
+   void* Allocate (size_t Bytes, size_t Alignment = alignof (std::max_align_t));
+   void Reset ();
+
+   private:
+
+   // Smallest block allocated, larger requests get a block of their own size.
+   static constexpr size_t BLOCK_BYTES = 1 << 20;
+
+   struct Block
+   {
+      std::unique_ptr<uint8_t[]> Memory;
+      size_t Size;
+   };
+
+   std::vector<Block> Blocks;
+   size_t Offset = 0;
+};
+
+// Fixed set of threads that run tasks for the native module. Every thread
+// has its own queue: tasks submitted from a pool thread go to the back of
+// its queue and it takes work from there, idle threads steal from the front
+// of the others. The threads live as long as the pool, Start and Stop run
+// once on each of them around everything it executes.
+class WorkPool
+{
+   public:
+
+   using Task = std::function<void ()>;
+
+   struct Hooks
+   {
+      std::function<void ()> Start;
+      std::function<void ()> Stop;
+   };
+
+   struct Counters
+   {
+      int64_t Executed;
+      int64_t Stolen;
+      size_t Queued;
+   };
+
+   // Size is clamped to at least one thread.
+   WorkPool (int Size, Hooks ThreadHooks = {});
+
+   // Runs what was already submitted and joins the threads. Must not be
+   // called from a pool thread.
+   ~WorkPool ();
+
+   // Tasks must not throw, anything they throw is dropped.
+   void Submit (Task Work);
+
+   // Runs Body for every index in [Begin, End) on the calling thread and
+   // idle pool threads and returns once all of them ran. Rethrows the first
+   // exception Body threw. Safe to call from inside a pool task, the caller
+   // never waits for an index nobody is running.
+   void ParallelFor (int Begin, int End, const std::function<void (int)>& Body);
+
+   int Size () const;
+   Counters Snapshot () const;
+
+   // The arena of the pool thread calling it, reset after every task it
+   // runs. Nothing when called from any other thread.
+   static ScratchArena* Arena ();
+
+   private:
+
+   struct Worker
+   {
+      std::mutex Lock;
+      std::deque<Task> Tasks;
+      ScratchArena Scratch;
+   };
+
+   Hooks ThreadHooks;
+
+   std::vector<std::unique_ptr<Worker>> Workers;
+   std::vector<std::thread> Threads;
+
+   // Queued tasks, changed under IdleLock when added so that a thread going
+   // to sleep never misses one
+   std::atomic<size_t> Pending = 0;
+
+   std::mutex IdleLock;
+   std::condition_variable Wake;
+   bool Stopping = false;
+
+   std::atomic<size_t> NextWorker = 0;
+
+   std::atomic<int64_t> Executed = 0;
+   std::atomic<int64_t> Stolen = 0;
+
+   void Run (size_t Index);
+   bool Take (size_t Index, Task& Work);
+};
\ No newline at end of file
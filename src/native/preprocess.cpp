@@ -0,0 +1,492 @@
+#include "preprocess.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/dnn.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+
+namespace {
+
+// Source pixels and weights for every output column or row of a bilinear
+// resize. They are computed the way cv::resize computes them for INTER_LINEAR
+// on 8-bit images: the source position in single precision, each weight
+// rounded to 11 fractional bits on its own.
+struct LinearTaps
+{
+   std::vector<int> First;
+   std::vector<int> Second;
+   std::vector<uint16_t> FirstWeight;
+   std::vector<uint16_t> SecondWeight;
+};
+
+const int WEIGHT_BITS = 11;
+const float WEIGHT_ONE = 1 << WEIGHT_BITS;
+
+// Horizontal sums are kept shifted right by this many bits, which is what
+// cv::resize keeps of them for its vertical pass. They fit 16 bits then.
+const int SUM_SHIFT = 4;
+
+// Bits left to round off once both weights were applied and the high half
+// of the vertical multiply was taken.
+const int ROUND_SHIFT = 2 * WEIGHT_BITS - SUM_SHIFT - 16;
+
+void ComputeTaps (int SourceSize, int TargetSize, LinearTaps& Taps)
+{
+   Taps.First.resize (TargetSize);
+   Taps.Second.resize (TargetSize);
+   Taps.FirstWeight.resize (TargetSize);
+   Taps.SecondWeight.resize (TargetSize);
+
+   // The inverse of the inverse scale, like cv::resize, it can differ from
+   // SourceSize / TargetSize in the last bit.
+   double Scale = 1.0 / ((double) TargetSize / SourceSize);
+
+   for (int i = 0; i < TargetSize; ++i) {
+      float Position = (float) ((i + 0.5) * Scale - 0.5);
+
+      int Offset = cvFloor (Position);
+      float Fraction = Position - Offset;
+
+      if (Offset < 0) {
+         Offset = 0;
+         Fraction = 0;
+      }
+
+      if (Offset >= SourceSize - 1) {
+         Offset = SourceSize - 1;
+         Fraction = 0;
+      }
+
+      Taps.First [i] = Offset;
+      Taps.Second [i] = std::min (Offset + 1, SourceSize - 1);
+      Taps.FirstWeight [i] = (uint16_t) cvRound ((1.f - Fraction) * WEIGHT_ONE);
+      Taps.SecondWeight [i] = (uint16_t) cvRound (Fraction * WEIGHT_ONE);
+   }
+}
+
+// Horizontally interpolates one source row into three planar rows in RGB
+// order, shifted right by SUM_SHIFT. Columns past the right edge of the
+// screenshot are the black padding.
+void InterpolateRow (
+   const cv::Mat& Image,
+   int Row,
+   const LinearTaps& Columns,
+   uint16_t* Red,
+   uint16_t* Green,
+   uint16_t* Blue
+) {
+   int Width = (int) Columns.First.size ();
+
+   if (Row >= Image.rows) {
+      std::fill (Red, Red + Width, 0);
+      std::fill (Green, Green + Width, 0);
+      std::fill (Blue, Blue + Width, 0);
+      return;
+   }
+
+   static const uint8_t Black [4] = { 0, 0, 0, 0 };
+
+   const uint8_t* Source = Image.ptr<uint8_t> (Row);
+
+   int Channels = Image.channels ();
+   int Cols = Image.cols;
+
+   for (int x = 0; x < Width; ++x) {
+      int First = Columns.First [x];
+      int Second = Columns.Second [x];
+
+      const uint8_t* A = First < Cols ? Source + First * Channels : Black;
+      const uint8_t* B = Second < Cols ? Source + Second * Channels : Black;
+
+      uint32_t WA = Columns.FirstWeight [x];
+      uint32_t WB = Columns.SecondWeight [x];
+
+      Blue [x] = (uint16_t) ((A [0] * WA + B [0] * WB) >> SUM_SHIFT);
+      Green [x] = (uint16_t) ((A [1] * WA + B [1] * WB) >> SUM_SHIFT);
+      Red [x] = (uint16_t) ((A [2] * WA + B [2] * WB) >> SUM_SHIFT);
+   }
+}
+
+// Vertically blends two horizontally interpolated rows, rounds back to 8-bit
+// the way the vectorized vertical pass of cv::resize does and scales the
+// result to [0, 1] like blobFromImage. Each row is weighted with the high
+// half of a 16-bit multiply, then the sum is rounded off by two more bits.
+void BlendRows (
+   const uint16_t* Top,
+   const uint16_t* Bottom,
+   uint16_t TopWeight,
+   uint16_t BottomWeight,
+   float* Destination,
+   int Width
+) {
+   const float Scale = (float) (1.0 / 255.0);
+   const uint16_t Round = 1 << (ROUND_SHIFT - 1);
+
+   int x = 0;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+   const int Lanes = cv::VTraits<cv::v_uint16>::vlanes ();
+   const int HalfLanes = cv::VTraits<cv::v_uint32>::vlanes ();
+
+   cv::v_uint16 VTopWeight = cv::vx_setall_u16 (TopWeight);
+   cv::v_uint16 VBottomWeight = cv::vx_setall_u16 (BottomWeight);
+   cv::v_uint16 VRound = cv::vx_setall_u16 (Round);
+   cv::v_float32 VScale = cv::vx_setall_f32 (Scale);
+
+   for (; x <= Width - Lanes; x += Lanes) {
+      cv::v_uint16 Sum = cv::v_add (
+         cv::v_mul_hi (cv::vx_load (Top + x), VTopWeight),
+         cv::v_mul_hi (cv::vx_load (Bottom + x), VBottomWeight)
+      );
+
+      cv::v_uint32 Low, High;
+
+      cv::v_expand (cv::v_shr<ROUND_SHIFT> (cv::v_add (Sum, VRound)), Low, High);
+
+      cv::v_store (Destination + x, cv::v_mul (cv::v_cvt_f32 (cv::v_reinterpret_as_s32 (Low)), VScale));
+      cv::v_store (Destination + x + HalfLanes, cv::v_mul (cv::v_cvt_f32 (cv::v_reinterpret_as_s32 (High)), VScale));
+   }
+#endif
+
+   for (; x < Width; ++x) {
+      uint32_t Sum = ((Top [x] * (uint32_t) TopWeight) >> 16) + ((Bottom [x] * (uint32_t) BottomWeight) >> 16);
+      Destination [x] = (float) ((Sum + Round) >> ROUND_SHIFT) * Scale;
+   }
+}
+
+}
+
+void LetterboxBlob (const cv::Mat& Image, cv::Mat& Blob, int Width, int Height)
+{
+   CV_Assert (Image.depth () == CV_8U && (Image.channels () == 3 || Image.channels () == 4));
+
+   bool IsAllocated = Blob.type () == CV_32F && Blob.dims == 4 &&
+      Blob.size [0] == 1 && Blob.size [1] == 3 &&
+      Blob.size [2] == Height && Blob.size [3] == Width;
+
+   if (!IsAllocated) {
+      Blob.create (std::vector<int> { 1, 3, Height, Width }, CV_32F);
+   }
+
+   // The screenshot sits in the top left corner of a black square.
+   int Max = std::max (Image.cols, Image.rows);
+
+   LinearTaps Columns;
+   LinearTaps Rows;
+
+   ComputeTaps (Max, Width, Columns);
+   ComputeTaps (Max, Height, Rows);
+
+   float* Planes = Blob.ptr<float> ();
+   size_t PlaneSize = (size_t) Width * Height;
+
+   cv::parallel_for_ (cv::Range (0, Height), [ & ] (const cv::Range& Range) {
+      // Two interpolated source rows, each split into R, G and B planes.
+      std::vector<uint16_t> Scratch (Width * 6);
+
+      uint16_t* Top = Scratch.data ();
+      uint16_t* Bottom = Scratch.data () + Width * 3;
+
+      int TopRow = -1;
+      int BottomRow = -1;
+
+      for (int y = Range.start; y < Range.end; ++y) {
+         int First = Rows.First [y];
+         int Second = Rows.Second [y];
+
+         if (First == BottomRow) {
+            std::swap (Top, Bottom);
+            std::swap (TopRow, BottomRow);
+         }
+
+         if (First != TopRow) {
+            InterpolateRow (Image, First, Columns, Top, Top + Width, Top + Width * 2);
+            TopRow = First;
+         }
+
+         if (Second != BottomRow) {
+            InterpolateRow (Image, Second, Columns, Bottom, Bottom + Width, Bottom + Width * 2);
+            BottomRow = Second;
+         }
+
+         for (int Channel = 0; Channel < 3; ++Channel) {
+            BlendRows (
+               Top + Width * Channel,
+               Bottom + Width * Channel,
+               Rows.FirstWeight [y],
+               Rows.SecondWeight [y],
+               Planes + PlaneSize * Channel + (size_t) y * Width,
+               Width
+            );
+         }
+      }
+   });
+}
+
+void LetterboxBlobReference (const cv::Mat& Image, cv::Mat& Blob, int Width, int Height)
+{
+   cv::Mat Converted;
+
+   if (Image.channels () == 4) {
+      cv::cvtColor (Image, Converted, cv::COLOR_BGRA2BGR);
+   } else {
+      Converted = Image;
+   }
+
+   int Max = std::max (Converted.cols, Converted.rows);
+
+   cv::Mat Square = cv::Mat::zeros (Max, Max, CV_8UC3);
+   Converted.copyTo (Square (cv::Rect (0, 0, Converted.cols, Converted.rows)));
+
+   cv::dnn::blobFromImage (
+      Square,
+      Blob,
+      1 / 255.0,
+      cv::Size (Width, Height),
+      cv::Scalar (),
+      true,
+      false
+   );
+}
+
+namespace {
+
+// Pixels of the tooltip frame trimmed from every side.
+const int TOOLTIP_BORDER = 5;
+
+// cv::cvtColor's fixed point BGR to gray weights.
+const int GRAY_SHIFT = 14;
+const uint32_t BLUE_WEIGHT = 1868;
+const uint32_t GREEN_WEIGHT = 9617;
+const uint32_t RED_WEIGHT = 4899;
+const uint32_t GRAY_ROUNDING = 1 << (GRAY_SHIFT - 1);
+
+typedef std::array<uint32_t, 256> Histogram;
+
+// Gray and binary images reused by every call on the same thread.
+struct BinarizeScratch
+{
+   cv::Mat Gray;
+   cv::Mat Binary;
+};
+
+thread_local BinarizeScratch Scratch;
+
+inline uint8_t Brighten (uint8_t Value)
+{
+   return (uint8_t) std::min (Value * 2, 255);
+}
+
+inline uint8_t Luminance (uint8_t Blue, uint8_t Green, uint8_t Red)
+{
+   return (uint8_t) ((Blue * BLUE_WEIGHT + Green * GREEN_WEIGHT + Red * RED_WEIGHT + GRAY_ROUNDING) >> GRAY_SHIFT);
+}
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+inline cv::v_uint32 Luminance (const cv::v_uint32& Blue, const cv::v_uint32& Green, const cv::v_uint32& Red)
+{
+   cv::v_uint32 Sum = cv::v_add (
+      cv::v_add (cv::v_mul (Blue, cv::vx_setall_u32 (BLUE_WEIGHT)), cv::v_mul (Green, cv::vx_setall_u32 (GREEN_WEIGHT))),
+      cv::v_add (cv::v_mul (Red, cv::vx_setall_u32 (RED_WEIGHT)), cv::vx_setall_u32 (GRAY_ROUNDING))
+   );
+
+   return cv::v_shr<GRAY_SHIFT> (Sum);
+}
+
+inline cv::v_uint16 Luminance (const cv::v_uint16& Blue, const cv::v_uint16& Green, const cv::v_uint16& Red)
+{
+   cv::v_uint32 Blue0, Blue1, Green0, Green1, Red0, Red1;
+
+   cv::v_expand (Blue, Blue0, Blue1);
+   cv::v_expand (Green, Green0, Green1);
+   cv::v_expand (Red, Red0, Red1);
+
+   return cv::v_pack (Luminance (Blue0, Green0, Red0), Luminance (Blue1, Green1, Red1));
+}
+
+inline cv::v_uint8 Luminance (cv::v_uint8 Blue, cv::v_uint8 Green, cv::v_uint8 Red)
+{
+   // Doubles the contrast, saturating like convertTo.
+   Blue = cv::v_add (Blue, Blue);
+   Green = cv::v_add (Green, Green);
+   Red = cv::v_add (Red, Red);
+
+   cv::v_uint16 Blue0, Blue1, Green0, Green1, Red0, Red1;
+
+   cv::v_expand (Blue, Blue0, Blue1);
+   cv::v_expand (Green, Green0, Green1);
+   cv::v_expand (Red, Red0, Red1);
+
+   return cv::v_pack (Luminance (Blue0, Green0, Red0), Luminance (Blue1, Green1, Red1));
+}
+#endif
+
+// Brightens and converts one row to gray and counts its gray levels.
+void GrayRow (const uint8_t* Source, int Channels, int Width, uint8_t* Gray, std::array<Histogram, 4>& Histograms)
+{
+   int x = 0;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+   const int Lanes = cv::VTraits<cv::v_uint8>::vlanes ();
+
+   for (; x + Lanes <= Width; x += Lanes) {
+      cv::v_uint8 Blue, Green, Red, Alpha;
+
+      if (Channels == 4) {
+         cv::v_load_deinterleave (Source + x * 4, Blue, Green, Red, Alpha);
+      } else {
+         cv::v_load_deinterleave (Source + x * 3, Blue, Green, Red);
+      }
+
+      cv::v_store (Gray + x, Luminance (Blue, Green, Red));
+   }
+#endif
+
+   for (; x < Width; ++x) {
+      const uint8_t* Pixel = Source + x * Channels;
+      Gray [x] = Luminance (Brighten (Pixel [0]), Brighten (Pixel [1]), Brighten (Pixel [2]));
+   }
+
+   // Tooltip backgrounds are long runs of one gray level, spreading them over
+   // four histograms keeps the increments from waiting on each other.
+   int i = 0;
+
+   for (; i + 4 <= Width; i += 4) {
+      ++Histograms [0][Gray [i]];
+      ++Histograms [1][Gray [i + 1]];
+      ++Histograms [2][Gray [i + 2]];
+      ++Histograms [3][Gray [i + 3]];
+   }
+
+   for (; i < Width; ++i) {
+      ++Histograms [0][Gray [i]];
+   }
+}
+
+// The same search cv::threshold runs for THRESH_OTSU on 8-bit images.
+int OtsuThreshold (const Histogram& Counts, size_t Total)
+{
+   double Scale = 1.0 / Total;
+   double Mean = 0;
+
+   for (int i = 0; i < 256; ++i) {
+      Mean += i * (double) Counts [i];
+   }
+
+   Mean *= Scale;
+
+   double Mean1 = 0;
+   double Weight1 = 0;
+   double BestSigma = 0;
+   int Best = 0;
+
+   for (int i = 0; i < 256; ++i) {
+      double Probability = Counts [i] * Scale;
+
+      Mean1 *= Weight1;
+      Weight1 += Probability;
+
+      double Weight2 = 1.0 - Weight1;
+
+      if (std::min (Weight1, Weight2) < FLT_EPSILON || std::max (Weight1, Weight2) > 1.0 - FLT_EPSILON) {
+         continue;
+      }
+
+      Mean1 = (Mean1 + i * Probability) / Weight1;
+
+      double Mean2 = (Mean - Weight1 * Mean1) / Weight2;
+      double Sigma = Weight1 * Weight2 * (Mean1 - Mean2) * (Mean1 - Mean2);
+
+      if (Sigma > BestSigma) {
+         BestSigma = Sigma;
+         Best = i;
+      }
+   }
+
+   return Best;
+}
+
+}
+
+void BinarizeTooltip (const cv::Mat& Region, cv::Mat& Binary)
+{
+   CV_Assert (Region.depth () == CV_8U && (Region.channels () == 3 || Region.channels () == 4));
+
+   int Width = Region.cols - 2 * TOOLTIP_BORDER;
+   int Height = Region.rows - 2 * TOOLTIP_BORDER;
+
+   if (Width <= 0 || Height <= 0) {
+      Binary = cv::Mat ();
+      return;
+   }
+
+   int Channels = Region.channels ();
+
+   Scratch.Gray.create (Height, Width, CV_8U);
+   Scratch.Binary.create (Height, Width, CV_8U);
+
+   std::array<Histogram, 4> Histograms = {};
+
+   for (int y = 0; y < Height; ++y) {
+      const uint8_t* Source = Region.ptr<uint8_t> (y + TOOLTIP_BORDER) + TOOLTIP_BORDER * Channels;
+      GrayRow (Source, Channels, Width, Scratch.Gray.ptr<uint8_t> (y), Histograms);
+   }
+
+   Histogram Counts;
+
+   for (int i = 0; i < 256; ++i) {
+      Counts [i] = Histograms [0][i] + Histograms [1][i] + Histograms [2][i] + Histograms [3][i];
+   }
+
+   int Threshold = OtsuThreshold (Counts, (size_t) Width * Height);
+
+   // Tooltip text is brighter than its background, THRESH_BINARY_INV turns
+   // it dark for Tesseract.
+   for (int y = 0; y < Height; ++y) {
+      const uint8_t* Gray = Scratch.Gray.ptr<uint8_t> (y);
+      uint8_t* Out = Scratch.Binary.ptr<uint8_t> (y);
+
+      int x = 0;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+      const int Lanes = cv::VTraits<cv::v_uint8>::vlanes ();
+
+      cv::v_uint8 Limit = cv::vx_setall_u8 ((uint8_t) Threshold);
+
+      for (; x + Lanes <= Width; x += Lanes) {
+         cv::v_store (Out + x, cv::v_le (cv::vx_load (Gray + x), Limit));
+      }
+#endif
+
+      for (; x < Width; ++x) {
+         Out [x] = Gray [x] > Threshold ? 0 : 255;
+      }
+   }
+
+   Binary = Scratch.Binary;
+}
+
+void BinarizeTooltipReference (const cv::Mat& Region, cv::Mat& Binary)
+{
+   cv::Mat Processed;
+
+   Region.convertTo (Processed, -1, 2, 0);
+
+   Processed = Processed (cv::Rect (
+      TOOLTIP_BORDER, 
+      TOOLTIP_BORDER, 
+      Processed.cols - 2 * TOOLTIP_BORDER,
+      Processed.rows - 2 * TOOLTIP_BORDER
+   ));
+
+   cv::Mat Grayscale;
+   cv::Mat Thresholded;
+
+   cv::cvtColor (Processed, Grayscale, cv::COLOR_BGR2GRAY);
+   cv::threshold (Grayscale, Thresholded, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+   cv::bilateralFilter (Thresholded, Binary, 5, 75, 75);
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+
+// Builds the detector input straight from a BGR or BGRA screenshot in a single
+// pass. This is equivalent to padding the screenshot with black to a square,
+// then calling cv::dnn::blobFromImage with a 1 / 255 scale, a Width x Height
+// size and swapped red / blue channels, but without any full size copies.
+// The result matches LetterboxBlobReference bit for bit, see test/preprocess.cpp.
+// cv::resize averages 2x2 blocks with INTER_AREA at an exact 2x downscale,
+// which equals the interpolation here at that scale.
+//
+// Blob is reused when it already is a 1x3xHeightxWidth CV_32F tensor.
+void LetterboxBlob (const cv::Mat& Image, cv::Mat& Blob, int Width, int Height);
+
+// The cvtColor, pad and blobFromImage chain LetterboxBlob replaced. Only used
+// to compare the two.
+void LetterboxBlobReference (const cv::Mat& Image, cv::Mat& Blob, int Width, int Height);
+
+// Prepares a BGR or BGRA tooltip crop for OCR. The frame border is trimmed,
+// the contrast doubled and the crop converted to gray and thresholded with
+// Otsu into dark text on white, in two passes over the pixels. The result
+// matches convertTo, cvtColor and threshold with THRESH_OTSU bit for bit.
+//
+// Binary points into a per thread buffer that the next call on the same
+// thread overwrites.
+void BinarizeTooltip (const cv::Mat& Region, cv::Mat& Binary);
+
+// The OpenCV chain BinarizeTooltip replaced, including its bilateral filter.
+// Only used to compare the two.
+void BinarizeTooltipReference (const cv::Mat& Region, cv::Mat& Binary);
\ No newline at end of file
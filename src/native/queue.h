@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. Push never blocks, it fails when the queue is full so the
+// producer decides what to drop.
+template <typename T>
+class SpscQueue
+{
+   public:
+
+   // Capacity is rounded up to a power of two.
+   explicit SpscQueue (size_t Capacity)
+   {
+      size_t Size = 1;
+
+      while (Size < Capacity) {
+         Size <<= 1;
+      }
+
+      Slots.resize (Size);
+      Mask = Size - 1;
+   }
+
+   // Producer only.
+   bool Push (T Item)
+   {
+      size_t Tail = Back.load (std::memory_order_relaxed);
+
+      if (Tail - Front.load (std::memory_order_acquire) > Mask) {
+         return false;
+      }
+
+      Slots [Tail & Mask] = std::move (Item);
+      Back.store (Tail + 1, std::memory_order_release);
+
+      return true;
+   }
+
+   // Consumer only.
+   std::optional<T> Pop ()
+   {
+      size_t Head = Front.load (std::memory_order_relaxed);
+
+      if (Head == Back.load (std::memory_order_acquire)) {
+         return std::nullopt;
+      }
+
+      // Moving out leaves nothing behind that would keep, say, a frame alive.
+      std::optional<T> Item (std::move (Slots [Head & Mask]));
+      Slots [Head & Mask] = T ();
+
+      Front.store (Head + 1, std::memory_order_release);
+
+      return Item;
+   }
+
+   // Items waiting, exact from either end and approximate from anywhere else.
+   size_t Size () const
+   {
+      return Back.load (std::memory_order_acquire) - Front.load (std::memory_order_acquire);
+   }
+
+   size_t Capacity () const
+   {
+      return Mask + 1;
+   }
+
+   private:
+
+   std::vector<T> Slots;
+   size_t Mask;
+
+   // Kept on separate cache lines so the two threads do not contend.
+   alignas (64) std::atomic<size_t> Front = 0;
+   alignas (64) std::atomic<size_t> Back = 0;
+};
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include "decode.h"
+#include "logger.h"
+#include "scanner.h"
+#include "stats.h"
+#include <algorithm>
+#include <combaseapi.h>
+#include <exception>
+
+namespace
+{
+   // Initializes COM for the calling stage thread for as long as it runs,
+   // capture goes through COM objects.
+   class ComScope
+   {
+      public:
+
+      ComScope () : Initialized (SUCCEEDED (CoInitializeEx (nullptr, COINIT_APARTMENTTHREADED)))
+      {
+      }
+
+      ~ComScope ()
+      {
+         if (Initialized) {
+            CoUninitialize ();
+         }
+      }
+
+      private:
+
+      bool Initialized;
+   };
+}
+
+Scanner::Scanner (std::shared_ptr<Screen> ScreenPtr, Listener OnChange, int IntervalMs) : ScreenObj (std::move (ScreenPtr)),
+   OnChange (std::move (OnChange)),
+   Interval (std::max (1, IntervalMs)),
+   Captured (QUEUE_CAPACITY),
+   Detected (QUEUE_CAPACITY)
+{
+}
+
+Scanner::~Scanner ()
+{
+   Stop ();
+}
+
+void Scanner::Start ()
+{
+   if (Running.exchange (true)) {
+      return;
+   }
+
+   for (Counter* Each : { &Captures, &Detections, &Reads }) {
+      Each->Frames = 0;
+      Each->PeakDepth = 0;
+   }
+
+   Changes = 0;
+   Dropped = 0;
+
+   Started = std::chrono::steady_clock::now ();
+
+   CaptureThread = std::thread (&Scanner::CaptureLoop, this);
+   DetectThread = std::thread (&Scanner::DetectLoop, this);
+   ReadThread = std::thread (&Scanner::ReadLoop, this);
+
+   Logger::log (
+      Logger::Level::E_INFO,
+      "Started scanning every " + std::to_string (Interval.count ()) + "ms"
+   );
+}
+
+void Scanner::Stop ()
+{
+   if (!Running.exchange (false)) {
+      return;
+   }
+
+   Notify (CapturedReady);
+   Notify (DetectedReady);
+
+   for (std::thread* Thread : { &CaptureThread, &DetectThread, &ReadThread }) {
+      if (Thread->joinable ()) {
+         Thread->join ();
+      }
+   }
+
+   // Drop what was still in flight so the frames return to their pool.
+   while (Captured.Pop ()) {
+   }
+
+   while (Detected.Pop ()) {
+   }
+
+   Shown = std::nullopt;
+
+   Logger::log (
+      Logger::Level::E_INFO,
+      "Stopped scanning"
+   );
+}
+
+void Scanner::Aim (std::optional<Screen::Cursor> Position, std::vector<cv::Rect> Exclusions)
+{
+   std::lock_guard<std::mutex> Guard (AimLock);
+
+   this->Position = Position;
+   this->Exclusions = std::move (Exclusions);
+}
+
+Scanner::Status Scanner::Snapshot ()
+{
+   std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now () - Started;
+
+   bool IsRunning = Running.load ();
+   double Seconds = IsRunning ? Elapsed.count () : 0.0;
+
+   return {
+      IsRunning,
+      Seconds,
+      Describe (Captures, 0, Seconds),
+      Describe (Detections, Captured.Size (), Seconds),
+      Describe (Reads, Detected.Size (), Seconds),
+      Changes.load (),
+      Dropped.load (),
+      QUEUE_CAPACITY
+   };
+}
+
+void Scanner::CaptureLoop ()
+{
+   ComScope Com;
+
+   FrameRef Previous;
+
+   auto Next = std::chrono::steady_clock::now ();
+
+   while (Running.load ()) {
+      Next += Interval;
+
+      try {
+         FrameRef Screenshot = ScreenObj->Capture ();
+
+         // Without a new frame the capture returns the previous one again,
+         // which has been looked at already.
+         if (Screenshot && Screenshot != Previous) {
+            Previous = Screenshot;
+            Measure (Captures, 0);
+
+            if (Captured.Push (std::move (Screenshot))) {
+               Notify (CapturedReady);
+            } else {
+               Dropped += 1;
+               Stats::count ("scanner.dropped");
+            }
+         }
+      } catch (const std::exception& E) {
+         Logger::log (
+            Logger::Level::E_ERROR,
+            std::string ("Scanner failed to capture the screen: ") + E.what ()
+         );
+      }
+
+      // Captures that fell behind are not made up for.
+      auto Now = std::chrono::steady_clock::now ();
+
+      if (Next < Now) {
+         Next = Now;
+      }
+
+      std::this_thread::sleep_until (Next);
+   }
+}
+
+void Scanner::DetectLoop ()
+{
+   ComScope Com;
+
+   while (Running.load ()) {
+      size_t Depth = Captured.Size ();
+      std::optional<FrameRef> Screenshot = Captured.Pop ();
+
+      if (!Screenshot) {
+         Await (CapturedReady, Captured);
+         continue;
+      }
+
+      Located Found { std::move (*Screenshot) };
+
+      try {
+         Stats::Timer Timer ("scanner.detect");
+
+         std::optional<Screen::Cursor> Cursor;
+         std::vector<cv::Rect> Excluded;
+
+         {
+            std::lock_guard<std::mutex> Guard (AimLock);
+
+            Cursor = Position;
+            Excluded = Exclusions;
+         }
+
+         // An unchanged screen still shows the tooltip read last time.
+         Found.Recalled = ScreenObj->Recall (Found.Screenshot->Image);
+
+         if (!Found.Recalled) {
+            if (std::optional<std::vector<cv::Rect>> Tooltips = ScreenObj->Locate (Found.Screenshot->Image, Cursor, Excluded)) {
+               Found.Tooltips = std::move (*Tooltips);
+            }
+         }
+      } catch (const std::exception& E) {
+         Logger::log (
+            Logger::Level::E_ERROR,
+            std::string ("Scanner failed to find tooltips: ") + E.what ()
+         );
+
+         continue;
+      }
+
+      Measure (Detections, Depth);
+
+      if (Detected.Push (std::move (Found))) {
+         Notify (DetectedReady);
+      } else {
+         Dropped += 1;
+         Stats::count ("scanner.dropped");
+      }
+   }
+}
+
+void Scanner::ReadLoop ()
+{
+   ComScope Com;
+
+   while (Running.load ()) {
+      size_t Depth = Detected.Size ();
+      std::optional<Located> Found = Detected.Pop ();
+
+      if (!Found) {
+         Await (DetectedReady, Detected);
+         continue;
+      }
+
+      std::optional<Screen::Reading> Current = std::move (Found->Recalled);
+
+      try {
+         Stats::Timer Timer ("scanner.read");
+
+         // Every enabled section is read at once, a follow-up would only
+         // report the same tooltip twice.
+         if (!Current && !Found->Tooltips.empty ()) {
+            Current = ScreenObj->ReadBest (Found->Screenshot->Image, Found->Tooltips, Screen::EnabledSections);
+
+            if (Current) {
+               ScreenObj->Remember (Found->Screenshot->Image, *Current);
+            }
+         }
+      } catch (const std::exception& E) {
+         Logger::log (
+            Logger::Level::E_ERROR,
+            std::string ("Scanner failed to read a tooltip: ") + E.what ()
+         );
+
+         continue;
+      }
+
+      Measure (Reads, Depth);
+
+      if (Changed (Current)) {
+         Changes += 1;
+         OnChange (Current);
+      }
+   }
+}
+
+bool Scanner::Changed (const std::optional<Screen::Reading>& Current)
+{
+   bool IsSame = Current.has_value () == Shown.has_value ();
+
+   if (IsSame && Current) {
+      IsSame =
+         Current->Text.Sections == Shown->Text.Sections &&
+         Overlap (Current->Tooltip, Shown->Tooltip) >= SAME_TOOLTIP_OVERLAP;
+   }
+
+   if (IsSame) {
+      return false;
+   }
+
+   Shown = Current;
+   return true;
+}
+
+void Scanner::Notify (Signal& Of)
+{
+   std::lock_guard<std::mutex> Guard (Of.Lock);
+   Of.Ready.notify_one ();
+}
+
+void Scanner::Measure (Counter& Of, size_t Depth)
+{
+   Of.Frames += 1;
+
+   size_t Peak = Of.PeakDepth.load ();
+
+   while (Depth > Peak && !Of.PeakDepth.compare_exchange_weak (Peak, Depth)) {
+   }
+}
+
+Scanner::Stage Scanner::Describe (const Counter& Of, size_t Depth, double Seconds)
+{
+   int64_t Frames = Of.Frames.load ();
+
+   return {
+      Frames,
+      Seconds > 0 ? Frames / Seconds : 0.0,
+      Depth,
+      Of.PeakDepth.load ()
+   };
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "frame.h"
+#include "queue.h"
+#include "screen.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <opencv2/core/types.hpp>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Scans the screen continuously. Capture, detection and OCR run as pipeline
+// stages on their own threads joined by bounded lock-free queues, so the next
+// frame is detected while the previous one is read. Results are only
+// reported when the tooltip on screen changes.
+class Scanner
+{
+   public:
+
+   // Called from the OCR stage with the tooltip now on screen, or nothing
+   // when it went away.
+   using Listener = std::function<void (const std::optional<Screen::Reading>&)>;
+
+   struct Stage
+   {
+      // Frames the stage finished and how many it does per second since
+      // the scanner started.
+      int64_t Frames;
+      double Rate;
+
+      // Frames waiting in the queue in front of the stage, and the most
+      // that ever did.
+      size_t Depth;
+      size_t PeakDepth;
+   };
+
+   struct Status
+   {
+      bool Running;
+      double Seconds;
+
+      Stage Capture;
+      Stage Detect;
+      Stage Read;
+
+      // Results reported and frames dropped because the next stage was full
+      int64_t Changes;
+      int64_t Dropped;
+
+      size_t Capacity;
+   };
+
+   Scanner (std::shared_ptr<Screen> ScreenPtr, Listener OnChange, int IntervalMs);
+   ~Scanner ();
+
+   void Start ();
+
+   // Waits for every stage to finish the frame it is on.
+   void Stop ();
+
+   // Where to look for the hovered item's tooltip and which tooltips the
+   // overlay draws itself, as for getTooltip. Applies from the next frame.
+   void Aim (std::optional<Screen::Cursor> Position, std::vector<cv::Rect> Exclusions);
+
+   Status Snapshot ();
+
+   private:
+
+   // Frames in flight between two stages. Two keep the next stage busy
+   // without it working on frames that are long outdated.
+   static constexpr size_t QUEUE_CAPACITY = 2;
+
+   // Readings of boxes overlapping at least this much with the same text
+   // are the same tooltip.
+   static constexpr double SAME_TOOLTIP_OVERLAP = 0.8;
+
+   struct Located
+   {
+      FrameRef Screenshot;
+
+      // Ranked candidates, or the reading recalled for an unchanged screen.
+      std::vector<cv::Rect> Tooltips;
+      std::optional<Screen::Reading> Recalled;
+   };
+
+   struct Counter
+   {
+      std::atomic<int64_t> Frames = 0;
+      std::atomic<size_t> PeakDepth = 0;
+   };
+
+   // Wakes the stage behind a queue when a frame was pushed to it or the
+   // scanner stops, an idle stage sleeps until then.
+   struct Signal
+   {
+      std::mutex Lock;
+      std::condition_variable Ready;
+   };
+
+   std::shared_ptr<Screen> ScreenObj;
+   Listener OnChange;
+   std::chrono::milliseconds Interval;
+
+   SpscQueue<FrameRef> Captured;
+   SpscQueue<Located> Detected;
+
+   Signal CapturedReady;
+   Signal DetectedReady;
+
+   std::atomic<bool> Running = false;
+   std::chrono::steady_clock::time_point Started;
+
+   std::thread CaptureThread;
+   std::thread DetectThread;
+   std::thread ReadThread;
+
+   std::mutex AimLock;
+   std::optional<Screen::Cursor> Position;
+   std::vector<cv::Rect> Exclusions;
+
+   Counter Captures;
+   Counter Detections;
+   Counter Reads;
+
+   std::atomic<int64_t> Changes = 0;
+   std::atomic<int64_t> Dropped = 0;
+
+   // Last reported tooltip, only touched by the OCR stage
+   std::optional<Screen::Reading> Shown;
+
+   void CaptureLoop ();
+   void DetectLoop ();
+   void ReadLoop ();
+
+   // Whether Current is a different tooltip than the one shown, and makes
+   // it the shown one when it is.
+   bool Changed (const std::optional<Screen::Reading>& Current);
+
+   // Waits until Queue has a frame or the scanner stops.
+   template <typename T>
+   void Await (Signal& Of, const SpscQueue<T>& Queue)
+   {
+      std::unique_lock<std::mutex> Guard (Of.Lock);
+
+      Of.Ready.wait (Guard, [ & ] () {
+         return Queue.Size () > 0 || !Running.load ();
+      });
+   }
+
+   // Taking the lock orders the notification after a waiter's check of the
+   // queue, so it is never missed.
+   static void Notify (Signal& Of);
+
+   static void Measure (Counter& Of, size_t Depth);
+   static Stage Describe (const Counter& Of, size_t Depth, double Seconds);
+};
\ No newline at end of file
@@ -1,8 +1,18 @@
+#include "decode.h"
 #include "logger.h"
+#include "preprocess.h"
 #include "screen.h"
+#include "stats.h"
+#include "trace.h"
 #include "util.h"
+#include <algorithm>
 #include <chrono>
+#include <climits>
+#include <cmath>
 #include <dxgi1_6.h>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/opencv.hpp>
@@ -15,13 +25,32 @@
 
 std::string Screen::TesseractPath = "";
 std::string Screen::OnnxFile = "";
+std::string Screen::EngineName = "auto";
+bool Screen::UseQuantizedModel = true;
+int Screen::InputSize = 640;
+bool Screen::UseBorderDetector = false;
+bool Screen::UseLineSegmentation = true;
+bool Screen::UseGlyphReader = false;
+std::vector<std::string> Screen::FontFiles;
+size_t Screen::ReadCacheBytes = 16 * 1024 * 1024;
+int Screen::OcrXHeight = 20;
+SectionSet Screen::EnabledSections = { true, true, true, true };
+bool Screen::UseTwoPhaseRead = true;
+
+// Whether the calling work pool thread joined a COM apartment.
+static thread_local bool HasApartment = false;
 
 Screen::~Screen () 
 {
    Cleanup ();
+   
+   // Joins the pool threads, which is why the screen must never be released
+   // last by one of its own tasks.
+   Workers.reset ();
 }
 
-Screen::Screen () : IsInitialized (false), MainThreadId (std::this_thread::get_id ())
+Screen::Screen () : IsInitialized (false), MainThreadId (std::this_thread::get_id ()),
+   Frames (std::make_shared<FramePool> ())
 {
 }
 
@@ -44,40 +73,92 @@ bool Screen::Initialize ()
    );
    
    try {
-      if (!Tesseract) {
+      if (Readers.Size () == 0) {
+         // One instance per core lets every candidate be read at once,
+         // each instance holds its own copy of the language model.
+         int Size = std::clamp ((int) std::thread::hardware_concurrency (), 1, MAXIMUM_TESSERACT_INSTANCES);
+         
          Logger::log (
             Logger::Level::E_INFO, 
-            "Initializing Tesseract"
+            "Initializing " + std::to_string (Size) + " Tesseract instances"
          );
          
-         Tesseract = std::make_unique<tesseract::TessBaseAPI> ();
-         
-         if (Tesseract->Init (TesseractPath.c_str (), "eng", tesseract::OEM_LSTM_ONLY) != 0) {
-            Logger::log (
-               Logger::Level::E_ERROR,
-               "Failed to initialize tesseract using datapath: " + TesseractPath
-            );
-            
+         if (!Readers.Initialize (TesseractPath, Size)) {
             Cleanup ();
             return false;
          }
+      }
+      
+      // Scans and the lines and candidates they read run on this pool, one
+      // thread per Tesseract instance so every instance can be kept busy.
+      // Each thread joins a COM apartment once, capture goes through COM.
+      if (!Workers) {
+         WorkPool::Hooks Apartment;
+         
+         Apartment.Start = [] () {
+            HRESULT Result = CoInitializeEx (nullptr, COINIT_APARTMENTTHREADED);
+            
+            HasApartment = SUCCEEDED (Result);
+            
+            if (!HasApartment) {
+               Logger::log (Result, "Failed to initialize COM on a work pool thread");
+            }
+         };
+         
+         Apartment.Stop = [] () {
+            if (HasApartment) {
+               CoUninitialize ();
+            }
+         };
          
-         Tesseract->SetPageSegMode (tesseract::PSM_SINGLE_BLOCK);
-         Tesseract->SetVariable ("debug_file", "/dev/null");
-         Tesseract->SetVariable ("user_defined_dpi", "70");
+         Workers = std::make_unique<WorkPool> (Readers.Size (), Apartment);
+      }
+      
+      ReadCache.SetCapacity (ReadCacheBytes);
+      
+      // Glyphs are only rendered once a line of their size is read, loading
+      // the fonts is cheap enough to also do it when only benchmarking.
+      if (Glyphs.Empty () && !FontFiles.empty () && !Glyphs.Initialize (FontFiles)) {
+         Logger::log (
+            Logger::Level::E_WARNING,
+            "No glyph fonts could be loaded, every line is read with Tesseract"
+         );
       }
       
-      if (!Net) {
+      if (!Engine) {
          Logger::log (
             Logger::Level::E_INFO, 
             "Initializing ONNX model"
          );
 
-         Net = std::make_unique<cv::dnn::Net> (
-            cv::dnn::readNetFromONNX (OnnxFile)
-         );
+         // Ordered from most to least preferred, the FP32 model at the
+         // default input size is always the last resort.
+         for (const ModelCandidate& Candidate : ModelCandidates ()) {
+            InputWidth = Candidate.Size;
+            InputHeight = Candidate.Size;
+            
+            Engine = LoadInferenceEngine (Candidate.File);
+            
+            if (Engine) {
+               ModelFile = Candidate.File;
+               
+               Logger::log (
+                  Logger::Level::E_INFO,
+                  "Loaded tooltip recognition model: " + Candidate.File + 
+                  " (" + std::to_string (Candidate.Size) + "x" + std::to_string (Candidate.Size) + ")"
+               );
+               
+               break;
+            }
+            
+            Logger::log (
+               Logger::Level::E_WARNING,
+               "Failed to load tooltip recognition model: " + Candidate.File + 
+               " at " + std::to_string (Candidate.Size) + "x" + std::to_string (Candidate.Size)
+            );
+         }
          
-         if (Net->empty ()) {
+         if (!Engine) {
             Logger::log (
                Logger::Level::E_ERROR, 
                "Failed to load tooltip recognition model from: " + OnnxFile
@@ -86,24 +167,6 @@ bool Screen::Initialize ()
             Cleanup ();
             return false;
          }
-         
-         if (cv::cuda::getCudaEnabledDeviceCount () > 0) {
-            Logger::log (
-               Logger::Level::E_INFO,
-               "CUDA is available, enabling GPU acceleration"
-            );
-            
-            Net->setPreferableBackend (cv::dnn::DNN_BACKEND_CUDA);
-            Net->setPreferableTarget (cv::dnn::DNN_TARGET_CUDA);
-         } else {
-            Logger::log (
-               Logger::Level::E_INFO, 
-               "CUDA not available, using CPU"
-            );
-            
-            Net->setPreferableBackend (cv::dnn::DNN_BACKEND_OPENCV);
-            Net->setPreferableTarget (cv::dnn::DNN_TARGET_CPU);
-         }
       }
 
       Logger::log (
@@ -214,24 +277,29 @@ void Screen::Cleanup ()
    // WGCInstance cleanup handled by unique_ptr
    WGCInstance.reset();
    
-   std::lock_guard<std::mutex> Lock (FrameMutex);
-   LatestFrame = cv::Mat ();
-   BackupFrame = cv::Mat ();
-   HasNewFrame = false;
+   // The capture manager has been stopped so nothing is publishing anymore.
+   LatestFrame.Reset ();
    
-   if (Tesseract) {
-      Tesseract->End ();
-      Tesseract.reset ();
+   {
+      std::lock_guard<std::mutex> RecallGuard (RecallLock);
+      LastReading = std::nullopt;
+      LastTiles.Clear ();
+      Tracker.Clear ();
    }
    
-   if (Net) {
-      Net.reset ();
+   // Waits for reads that are still in flight.
+   Readers.Clear ();
+   Glyphs.Clear ();
+   ReadCache.Clear ();
+   
+   if (Engine) {
+      Engine.reset ();
    }
    
    IsInitialized = false;
 }
 
-std::optional<cv::Mat> Screen::Capture () 
+FrameRef Screen::Capture () 
 {
    if (!IsInitialized) {
       throw std::runtime_error ("Cannot capture screen before initialization");
@@ -242,6 +310,8 @@ std::optional<cv::Mat> Screen::Capture ()
       "Capture called, method: " + std::to_string (static_cast<int>(CurrentCaptureMethod))
    );
    
+   Stats::Timer Timer ("capture");
+   
    std::lock_guard<std::mutex> Lock (CaptureLock);
    
    if (CurrentCaptureMethod == CaptureMethod::WindowsGraphicsCapture && WGCInstance) {
@@ -253,7 +323,7 @@ std::optional<cv::Mat> Screen::Capture ()
              "Failed to find game window for capture"
          );
 
-         return std::nullopt;
+         return nullptr;
       }
 
       std::optional<cv::Mat> frame = WGCInstance->CaptureWindow (GameWindow);
@@ -264,46 +334,78 @@ std::optional<cv::Mat> Screen::Capture ()
             "Windows Graphics Capture failed to capture frame"
          );
         
-         return std::nullopt;
+         return nullptr;
       }
       
-      return frame;
+      // The WGC frame is already a private copy of the staging texture.
+      auto Captured = std::make_shared<Frame> ();
+      Captured->Image = std::move (*frame);
+      
+      return Captured;
    }
    
-   std::lock_guard<std::mutex> FrameLock (FrameMutex);
+   // Only one reader (guarded by CaptureLock) ever reads the latest frame slot.
+   bool IsNew = false;
+   FrameRef Latest = LatestFrame.Read (IsNew);
    
    // Logger::log (
    //    Logger::Level::E_DEBUG,
-   //    "ScreenCaptureLite - HasNewFrame: " + std::to_string(HasNewFrame) + 
-   //    ", LatestFrame empty: " + std::to_string (LatestFrame.empty ()) +
-   //    ", BackupFrame empty: " + std::to_string (BackupFrame.empty ())
+   //    "ScreenCaptureLite - IsNew: " + std::to_string (IsNew) + 
+   //    ", Latest empty: " + std::to_string (!Latest)
    // );
    
-   if (!HasNewFrame || LatestFrame.empty ()) {
-      // Check if we have a backup frame to use
-      if (!BackupFrame.empty ()) {
-         Logger::log (
-            Logger::Level::E_DEBUG, 
-            "No new frame available, using backup frame"
-         );
-         return BackupFrame.clone ();
-      }
-      
+   if (!Latest) {
       Logger::log (
          Logger::Level::E_DEBUG, 
          "No new available frame has been buffered for capture and no backup frame exists"
       );
          
-      return std::nullopt;
+      return nullptr;
+   }
+   
+   if (!IsNew) {
+      Logger::log (
+         Logger::Level::E_DEBUG, 
+         "No new frame available, using backup frame"
+      );
    }
 
-   // Save current frame as backup before returning
-   BackupFrame = LatestFrame.clone ();
-   HasNewFrame = false;
-   return LatestFrame.clone ();
+   return Latest;
+}
+
+std::optional<std::vector<Detection>> Screen::FindTooltips (const cv::Mat& Screenshot, const std::vector<cv::Rect>& Excluded, const std::optional<Cursor>& Position) 
+{
+   std::optional<std::vector<Detection>> MaybeTooltips = DetectTooltips (Screenshot, Position);
+   
+   if (!MaybeTooltips || Excluded.empty ()) {
+      return MaybeTooltips;
+   }
+   
+   // The overlay is detected like any other tooltip, reading it only to
+   // throw its text away costs a whole OCR pass.
+   std::vector<Detection> Tooltips;
+   
+   for (const Detection& Tooltip : *MaybeTooltips) {
+      bool IsOverlay = std::any_of (Excluded.begin (), Excluded.end (), [ & ] (const cv::Rect& Overlay) {
+         return Overlap (Tooltip.Box, Overlay) >= OVERLAY_OVERLAP;
+      });
+      
+      if (IsOverlay) {
+         Stats::count ("detect.excluded");
+         continue;
+      }
+      
+      Tooltips.push_back (Tooltip);
+   }
+   
+   if (Tooltips.empty ()) {
+      return std::nullopt;
+   }
+   
+   return Tooltips;
 }
 
-std::optional<std::vector<cv::Rect>> Screen::FindTooltips (cv::Mat Screenshot) 
+std::optional<std::vector<Detection>> Screen::DetectTooltips (const cv::Mat& Screenshot, const std::optional<Cursor>& Position) 
 {
    if (!IsInitialized) {
       throw std::runtime_error ("Cannot find tooltip before initialization");
@@ -311,214 +413,1257 @@ std::optional<std::vector<cv::Rect>> Screen::FindTooltips (cv::Mat Screenshot)
    
    std::lock_guard<std::mutex> Lock (DNNLock);
    
-   if (Screenshot.channels () == 4) {
-      cv::cvtColor (Screenshot, Screenshot, cv::COLOR_BGRA2BGR);
+   // The frame art is easy to find without the model on most backgrounds,
+   // inference is only needed when it is not. Dark panels can still pass
+   // for a frame, so one is only trusted when the cursor is on or next to
+   // it, where the game opens the hovered item's tooltip.
+   if (UseBorderDetector && Position) {
+      Stats::Timer Timer ("detect.borders");
+      
+      const std::vector<BorderDetector::Frame>& Found = Borders.Detect (Screenshot);
+      
+      double Near = std::max (Position->Radius, 1) * RANK_DISTANCE_FALLOFF;
+      
+      bool IsHovered = std::any_of (Found.begin (), Found.end (), [ & ] (const BorderDetector::Frame& Tooltip) {
+         int Dx = std::max ({ Tooltip.Box.x - Position->X, 0, Position->X - (Tooltip.Box.br ().x - 1) });
+         int Dy = std::max ({ Tooltip.Box.y - Position->Y, 0, Position->Y - (Tooltip.Box.br ().y - 1) });
+         
+         return std::hypot (Dx, Dy) <= Near;
+      });
+      
+      if (IsHovered) {
+         Stats::count ("detect.borders.hits");
+         
+         // Every frame is kept for Rank, which weighs how well its sides
+         // matched the art by how far it is from the cursor.
+         std::vector<Detection> Framed;
+         
+         for (const BorderDetector::Frame& Tooltip : Found) {
+            Framed.push_back ({ Tooltip.Box, Tooltip.Match, 0 });
+         }
+         
+         return Framed;
+      }
+      
+      Stats::count ("detect.borders.misses");
+   }
+   
+   // Pads the screenshot to a square, resizes it, swaps red and blue and
+   // normalizes it into the reused input tensor in a single pass.
+   {
+      Stats::Timer Timer ("detect.letterbox");
+      
+      LetterboxBlob (
+         Screenshot, 
+         Blob, 
+         InputWidth, 
+         InputHeight
+      );
    }
    
    int Max = std::max (Screenshot.cols, Screenshot.rows);
    
-   cv::Mat Resized;
+   cv::Mat Output;
+   
+   {
+      Stats::Timer Timer ("detect.inference");
+      Output = Engine->Run (Blob);
+   }
+   
+   // -- -- //
+   
+   // The letterboxed square is scaled to the model input, scale boxes back up.
+   float XScale = (float) Max / InputWidth;
+   float YScale = (float) Max / InputHeight;
+   
+   Stats::Timer Timer ("detect.decode");
+   
+   // The output stays in its [1 x (4 + Classes) x Anchors] layout, only the
+   // anchors that pass the confidence threshold are decoded.
+   Decoder.Decode (
+      Output, 
+      (float) MINIMUM_OBJECT_CONFIDENCE, 
+      XScale, 
+      YScale
+   );
+   
+   // Non-maximum supression to remove redundant boxes.
+   const std::vector<Detection>& Kept = Decoder.Suppress (
+      (float) NMS_SCORE_THRESHOLD, 
+      (float) NMS_THRESHOLD
+   );
    
-   Resized = cv::Mat::zeros (Max, Max, CV_8UC3);
-   Screenshot.copyTo (Resized (cv::Rect (0, 0, Screenshot.cols, Screenshot.rows)));
+   if (Kept.empty ()) {
+      return std::nullopt;
+   }
    
-   cv::Mat Frame;
+   return Kept;
+}
+
+std::optional<std::vector<Detection>> Screen::FindTooltipsNear (const cv::Mat& Screenshot, const Cursor& Position, const std::vector<cv::Rect>& Excluded) 
+{
+   cv::Rect Bounds (0, 0, Screenshot.cols, Screenshot.rows);
    
-   cv::dnn::blobFromImage (
-      Resized, 
-      Frame, 
-      1 / 255.0,
-      cv::Size (MODEL_WIDTH, MODEL_HEIGHT), 
-      cv::Scalar (),
-      true, 
-      false
+   cv::Rect Region = Bounds & cv::Rect (
+      Position.X - Position.Radius,
+      Position.Y - Position.Radius,
+      Position.Radius * 2,
+      Position.Radius * 2
    );
    
-   Net->setInput (Frame);
+   // Cropping only pays off when the region is a small part of the screen.
+   if (Region.empty () || Region.area () * 2 > Bounds.area ()) {
+      return std::nullopt;
+   }
    
-   std::vector<cv::Mat> Outputs;
+   std::vector<cv::Rect> Shifted;
    
-   Net->forward (Outputs, Net->getUnconnectedOutLayersNames ());
+   for (const cv::Rect& Overlay : Excluded) {
+      Shifted.push_back (Overlay - Region.tl ());
+   }
    
-   // -- -- //
+   Cursor Inside { Position.X - Region.x, Position.Y - Region.y, Position.Radius };
    
-   int Rows = Outputs [0].size [2];
-   int Dimensions = Outputs [0].size [1];
+   std::optional<std::vector<Detection>> MaybeTooltips = FindTooltips (Screenshot (Region), Shifted, Inside);
    
-   Outputs [0] = Outputs [0].reshape (1, Dimensions);
-   cv::transpose (Outputs [0], Outputs [0]);
+   if (!MaybeTooltips) {
+      return std::nullopt;
+   }
    
-   float *Data = (float *) Outputs [0].data;
+   std::vector<Detection> Tooltips;
    
-   float XScale = (float) Resized.cols / MODEL_WIDTH;
-   float YScale = (float) Resized.rows / MODEL_HEIGHT;
+   for (Detection Found : *MaybeTooltips) {
+      const cv::Rect& Tooltip = Found.Box;
+      
+      // A tooltip touching a cropped edge of the region is likely cut off and
+      // only partially detected, leave it to the full frame scan.
+      bool IsClipped = 
+         (Region.x > 0 && Tooltip.x <= REGION_EDGE_MARGIN) ||
+         (Region.y > 0 && Tooltip.y <= REGION_EDGE_MARGIN) ||
+         (Region.br ().x < Bounds.width && Tooltip.br ().x >= Region.width - REGION_EDGE_MARGIN) ||
+         (Region.br ().y < Bounds.height && Tooltip.br ().y >= Region.height - REGION_EDGE_MARGIN);
+      
+      if (IsClipped) {
+         return std::nullopt;
+      }
+      
+      Found.Box += Region.tl ();
+      Tooltips.push_back (Found);
+   }
    
-   std::vector<int> ClassIds;
-   std::vector<float> Confidences;
-   std::vector<cv::Rect> Boxes;
+   return Tooltips;
+}
+
+void Screen::Rank (std::vector<Detection>& Tooltips, const Cursor& Position) 
+{
+   double Falloff = std::max (Position.Radius, 1) * RANK_DISTANCE_FALLOFF;
    
-   for (int i = 0; i < Rows; ++i) {
-      float *ClassesScores = Data + 4;
+   auto Score = [ & ] (const Detection& Tooltip) {
+      const cv::Rect& Box = Tooltip.Box;
       
-      cv::Mat Scores (1, MODEL_OBJECTS.size (), CV_32FC1, ClassesScores);
-      cv::Point ClassId;
+      // Distance to the nearest point of the box, zero inside it.
+      int Dx = std::max ({ Box.x - Position.X, 0, Position.X - (Box.br ().x - 1) });
+      int Dy = std::max ({ Box.y - Position.Y, 0, Position.Y - (Box.br ().y - 1) });
       
-      double MaxClassScore;
+      double Proximity = std::exp (-std::hypot (Dx, Dy) / Falloff);
       
-      cv::minMaxLoc (Scores, 0, &MaxClassScore, 0, &ClassId);
+      // The game opens tooltips beside the hovered slot, with the cursor
+      // level with some part of them.
+      double Placement = Dy == 0 ? 1.0 : RANK_OFF_SIDE;
       
-      if (MaxClassScore > MINIMUM_OBJECT_CONFIDENCE) {
-         Confidences.push_back (MaxClassScore);
-         ClassIds.push_back (ClassId.x);
-         
-         float X = Data [0];
-         float Y = Data [1];
-         float W = Data [2];
-         float H = Data [3];
-         
-         int Left = (int) ((X - 0.5 * W) * XScale);
-         int Top = (int) ((Y - 0.5 * H) * YScale);
-         
-         int Width = (int) (W * XScale);
-         int Height = (int) (H * YScale);
-         
-         Boxes.push_back (cv::Rect (Left, Top, Width, Height));
+      return Tooltip.Confidence * Proximity * Placement;
+   };
+   
+   std::vector<std::pair<double, Detection>> Scored;
+   
+   for (const Detection& Tooltip : Tooltips) {
+      Scored.emplace_back (Score (Tooltip), Tooltip);
+   }
+   
+   // Stable so equally scored boxes keep the detector's order.
+   std::stable_sort (Scored.begin (), Scored.end (), [] (const auto& A, const auto& B) {
+      return A.first > B.first;
+   });
+   
+   for (size_t i = 0; i < Scored.size (); ++i) {
+      Tooltips [i] = Scored [i].second;
+   }
+}
+
+std::optional<std::vector<cv::Rect>> Screen::Locate (const cv::Mat& Screenshot, const std::optional<Cursor>& Position, const std::vector<cv::Rect>& Excluded) 
+{
+   std::optional<std::vector<Detection>> MaybeTooltips;
+   
+   // A tooltip that is still on screen, maybe shifted a little, is found
+   // again by its corners which is far cheaper than inference.
+   {
+      Stats::Timer Timer ("detect.track");
+      
+      if (std::optional<cv::Rect> Tracked = Track (Screenshot)) {
+         MaybeTooltips = std::vector<Detection> { { *Tracked, 1.0f, 0 } };
       }
+   }
+   
+   // Tooltips are drawn next to the cursor so look there first and only
+   // scan the whole frame when nothing was found around it.
+   if (!MaybeTooltips && Position) {
+      Stats::Timer Timer ("detect.cursor");
+      MaybeTooltips = FindTooltipsNear (Screenshot, *Position, Excluded);
       
-      Data += Dimensions;
+      if (!MaybeTooltips) {
+         Stats::count ("detect.cursor.fallbacks");
+      }
    }
    
-   // Non-maximum supression to remove redundant boxes.
-   std::vector<int> Nms;
-   
-   cv::dnn::NMSBoxes (
-      Boxes, 
-      Confidences, 
-      NMS_SCORE_THRESHOLD, 
-      NMS_THRESHOLD,
-      Nms
-   );
+   if (!MaybeTooltips) {
+      Stats::Timer Timer ("detect.full");
+      MaybeTooltips = FindTooltips (Screenshot, Excluded, Position);
+   }
    
-   if (Nms.size () <= 0) {
+   if (!MaybeTooltips) {
+      Stats::sample ("scan.candidates", 0);
       return std::nullopt;
    }
    
+   std::vector<Detection>& Found = *MaybeTooltips;
+   
+   Stats::sample ("scan.candidates", (double) Found.size ());
+   
+   if (Position && Found.size () > 1) {
+      Rank (Found, *Position);
+   }
+   
    std::vector<cv::Rect> Tooltips;
    
-   for (int Idx : Nms) {
-      Tooltips.push_back (Boxes [Idx]);
+   for (const Detection& Candidate : Found) {
+      Tooltips.push_back (Candidate.Box);
    }
    
    return Tooltips;
 }
 
-std::string Screen::Read (cv::Mat Region) 
+std::optional<Screen::Reading> Screen::ReadBest (const cv::Mat& Screenshot, const std::vector<cv::Rect>& Tooltips, const SectionSet& Parts, const std::function<bool ()>& Stale) 
 {
-   if (!IsInitialized) {
-      throw std::runtime_error ("Cannot run OCR before initialization");
+   // The best ranked candidate is read first and nearly always is the
+   // hovered item's tooltip. Only when its text is not usable are the others
+   // read at once on the work pool, where the best ranked acceptable one
+   // wins: it cancels every candidate ranked after it but still waits for the
+   // ones before it.
+   std::vector<TooltipText> Texts (Tooltips.size ());
+   std::atomic<int> Winner (INT_MAX);
+   std::atomic<int> Calls (0);
+   
+   std::mutex FailureLock;
+   std::exception_ptr Failure;
+   
+   auto IsStale = [ & ] () {
+      return Stale && Stale ();
+   };
+   
+   auto ReadCandidates = [ & ] (const cv::Range& Range) {
+      for (int i = Range.start; i < Range.end; ++i) {
+         auto Cancelled = [ &Winner, &IsStale, i ] () {
+            return Winner.load () < i || IsStale ();
+         };
+         
+         if (IsStale ()) {
+            Stats::count ("scan.stale.ocr");
+            continue;
+         }
+         
+         try {
+            Calls += 1;
+            
+            TooltipText Text = Read (Screenshot (Tooltips [i]), Parts, Cancelled);
+            
+            if (Winner.load () < i) {
+               Stats::count ("ocr.cancelled");
+               continue;
+            }
+            
+            if (IsStale ()) {
+               Stats::count ("scan.stale.ocr");
+               continue;
+            }
+            
+            if (IsAcceptable (Text)) {
+               int Current = Winner.load ();
+               
+               while (i < Current && !Winner.compare_exchange_weak (Current, i)) {
+               }
+            }
+            
+            Texts [i] = std::move (Text);
+         } catch (...) {
+            std::lock_guard<std::mutex> Guard (FailureLock);
+            
+            if (!Failure) {
+               Failure = std::current_exception ();
+            }
+         }
+      }
+   };
+   
+   ReadCandidates (cv::Range (0, 1));
+   
+   if (Winner.load () != 0 && Tooltips.size () > 1 && !IsStale ()) {
+      Stats::count ("ocr.fallbacks");
+      
+      uint64_t Scan = Trace::current ();
+      
+      Workers->ParallelFor (1, (int) Tooltips.size (), [ & ] (int i) {
+         Trace::Scope Traced (Scan);
+         ReadCandidates (cv::Range (i, i + 1));
+      });
    }
    
-   std::lock_guard<std::mutex> Lock (TesseractLock);
+   Stats::sample ("scan.ocr_calls", Calls.load ());
    
-   cv::Mat Processed = cv::Mat::zeros (
-      Region.size (), 
-      Region.type ()
-   );
+   if (Winner.load () == INT_MAX) {
+      if (Failure) {
+         std::rethrow_exception (Failure);
+      }
+      
+      return std::nullopt;
+   }
    
-   // Alpha - contrast control (1.0 - 3.0)
-   // Brightness control - 0 (0 - 100)
-   Region.convertTo (Processed, -1, 2, 0);
+   return Reading { Tooltips [Winner.load ()], Texts [Winner.load ()] };
+}
+
+bool Screen::IsAcceptable (const TooltipText& Text) 
+{
+   const std::string& Header = Text.Sections [(int) Section::Header];
    
-   // Trim border
-   int BorderSize = 5;
+   if (Header.find_first_not_of (" \t\r\n") == std::string::npos) {
+      return false;
+   }
    
-   cv::Rect Roi (
-      BorderSize, 
-      BorderSize, 
-      Processed.cols - 2 * BorderSize,
-      Processed.rows - 2 * BorderSize
-   );
+   // The overlay's own tooltip was dropped by its rect already, its text is
+   // still checked in case it moved since the scan request.
+   return JoinSections (Text.Sections).find ("Item Statistics") == std::string::npos;
+}
+
+WorkPool& Screen::Pool () 
+{
+   if (!Workers) {
+      throw std::runtime_error ("Cannot schedule work before initialization");
+   }
    
-   Processed = Processed (Roi);
+   return *Workers;
+}
+
+TooltipText Screen::Read (const cv::Mat& Region, const std::function<bool ()>& Cancelled) 
+{
+   return Read (Region, EnabledSections, Cancelled);
+}
+
+TooltipText Screen::Read (const cv::Mat& Region, const SectionSet& Parts, const std::function<bool ()>& Cancelled) 
+{
+   ReadMode Mode = ReadMode::Block;
    
-   cv::Mat Grayscale;
-   cv::Mat Binary;
-   cv::Mat Sharpened;
+   if (UseLineSegmentation) {
+      Mode = UseGlyphReader ? ReadMode::Glyphs : ReadMode::Lines;
+   }
    
-   cv::cvtColor (
-      Processed, 
-      Grayscale, 
-      cv::COLOR_BGR2GRAY
-   );
+   cv::Mat Binary = Preprocess (Region);
    
-   cv::threshold (
-      Grayscale, 
-      Binary, 0, 255,
-      cv::THRESH_BINARY_INV | cv::THRESH_OTSU
-   );
+   if (ReadCache.Capacity () == 0) {
+      return ReadSections (Binary, Mode, Parts, Cancelled, ScaleText (Binary));
+   }
    
-   cv::bilateralFilter (Binary, Sharpened, 5, 75, 75);
+   // Hovering an item again shows the same tooltip, read it from the cache.
+   TextCache::Key Crop = TextCache::Describe (Binary);
    
-   Tesseract->SetImage (
-      Sharpened.data, 
-      Sharpened.cols, 
-      Sharpened.rows,
-      Sharpened.channels (), 
-      Sharpened.step
-   );
+   if (std::optional<TooltipText> Cached = ReadCache.Find (Crop)) {
+      Stats::count ("ocr.cache.hits");
+      return *Cached;
+   }
    
-   std::unique_ptr<char[]> Text (Tesseract->GetUTF8Text ());
+   Stats::count ("ocr.cache.misses");
    
-   if (Text) {
-      return std::string (Text.get ());
-   } else {
-      Logger::log (
-         Logger::Level::E_ERROR,
-         "Failed to extract text from image with Tesseract"
-      );
+   TooltipText Text = ReadSections (Binary, Mode, Parts, Cancelled, ScaleText (Binary));
+   
+   // Partial reads are cached by Complete once the rest is read.
+   if (Text.Covers (EnabledSections) && !JoinSections (Text.Sections).empty () && !(Cancelled && Cancelled ())) {
+      ReadCache.Insert (std::move (Crop), Text);
    }
    
-   return std::string ();
+   return Text;
 }
 
-bool Screen::InitializeScreenCaptureLite () 
+std::string Screen::Read (const cv::Mat& Region, ReadMode Mode, const std::function<bool ()>& Cancelled) 
 {
-   Logger::log (
-      Logger::Level::E_INFO,
-      "Initializing Screen Capture Lite"
-   );
-
-   auto GetMonitorsCallback = [] () {
-      auto Monitors = SL::Screen_Capture::GetMonitors ();
-      
-      for (const auto& M : Monitors) {
-         Logger::log (
-            Logger::Level::E_INFO,
-            "Monitor " + std::to_string (M.Id) + 
-            ": " + std::to_string (M.Width) + 
-            "x" + std::to_string (M.Height) +
-            " (Original: " + std::to_string (M.OriginalWidth) + "x" + std::to_string (M.OriginalHeight) + ") " +
-            "at (" + std::to_string (M.OffsetX) + "," + std::to_string (M.OffsetY) + ") " +
-            "Scaling: " + std::to_string (M.Scaling)
-         );
-      }
+   cv::Mat Binary = Preprocess (Region);
+   return ReadBinary (Binary, Mode, Cancelled, ScaleText (Binary));
+}
 
-      return Monitors;
-   };
+void Screen::Complete (const cv::Mat& Region, const cv::Rect& Tooltip, const TooltipText& Text) 
+{
+   if (ReadCache.Capacity () > 0 && !JoinSections (Text.Sections).empty ()) {
+      ReadCache.Insert (TextCache::Describe (Preprocess (Region)), Text);
+   }
+   
+   std::lock_guard<std::mutex> Lock (RecallLock);
+   
+   if (LastReading && LastReading->Tooltip == Tooltip) {
+      LastReading->Text = Text;
+   }
+}
 
-   auto Config = SL::Screen_Capture::CreateCaptureConfiguration (GetMonitorsCallback);
+cv::Mat Screen::Preprocess (const cv::Mat& Region) 
+{
+   if (!IsInitialized) {
+      throw std::runtime_error ("Cannot run OCR before initialization");
+   }
+   
+   Stats::Timer Timer ("ocr.preprocess");
+   
+   cv::Mat Binary;
+   BinarizeTooltip (Region, Binary);
+   
+   return Binary;
+}
 
-   Config->onNewFrame ([ this ] (const SL::Screen_Capture::Image& Img, const SL::Screen_Capture::Monitor& Monitor) {
-      // Logger::log (
-      //    Logger::Level::E_DEBUG,
-      //    "ScreenCaptureLite callback triggered for monitor " + std::to_string(Monitor.Id)
-      // );
-      
-      std::optional<int> CurrentGameMonitorId = GetGameMonitorId ();
+TextScale Screen::ScaleText (const cv::Mat& Binary) 
+{
+   TextScale Scale = FitXHeight (Binary, OcrXHeight);
+   
+   if (Scale.Factor != 1.0) {
+      Stats::count ("ocr.rescaled");
+   }
+   
+   return Scale;
+}
 
-      if (!CurrentGameMonitorId.has_value () || CurrentGameMonitorId.value () == Monitor.Id) {
-         int Height = SL::Screen_Capture::Height (Img);
-         int Width = SL::Screen_Capture::Width (Img);
+std::string Screen::ReadBinary (const cv::Mat& Binary, ReadMode Mode, const std::function<bool ()>& Cancelled, const TextScale& Scale) 
+{
+   if (Mode == ReadMode::Block) {
+      TesseractPool::Lease Tesseract = Readers.Acquire ();
+      return RecognizeText (*Tesseract, Binary, tesseract::PSM_SINGLE_BLOCK, Cancelled, Scale);
+   }
+   
+   std::vector<std::string> Lines = ReadStrips (Binary, SegmentLines (Binary), tesseract::PSM_SINGLE_LINE, Mode == ReadMode::Glyphs, Cancelled, Scale);
+   std::string Text;
+   
+   for (const std::string& Line : Lines) {
+      if (!Line.empty ()) {
+         Text += Line + "\n";
+      }
+   }
+   
+   return Text;
+}
+
+TooltipText Screen::ReadSections (const cv::Mat& Binary, ReadMode Mode, const SectionSet& Parts, const std::function<bool ()>& Cancelled, const TextScale& Scale) 
+{
+   std::vector<cv::Range> Strips;
+   std::vector<Section> Owners;
+   
+   // Sections no enabled overlay component shows are never read, the others
+   // may be left for a later read. Blocks are read a section at a time so
+   // their text can be told apart.
+   for (const SectionLayout& Layout : SegmentSections (Binary)) {
+      if (!Parts [(int) Layout.Part]) {
+         if (!EnabledSections [(int) Layout.Part]) {
+            Stats::count ("ocr.sections.skipped");
+         }
+         
+         continue;
+      }
+      
+      if (Mode == ReadMode::Block) {
+         Strips.emplace_back (Layout.Lines.front ().start, Layout.Lines.back ().end);
+         Owners.push_back (Layout.Part);
+         continue;
+      }
+      
+      for (const cv::Range& Line : Layout.Lines) {
+         Strips.push_back (Line);
+         Owners.push_back (Layout.Part);
+      }
+   }
+   
+   tesseract::PageSegMode PageMode = Mode == ReadMode::Block ? tesseract::PSM_SINGLE_BLOCK : tesseract::PSM_SINGLE_LINE;
+   std::vector<std::string> Texts = ReadStrips (Binary, Strips, PageMode, Mode == ReadMode::Glyphs, Cancelled, Scale);
+   
+   // Sections missing from this tooltip count as read, they are empty.
+   TooltipText Text;
+   Text.Read = Parts;
+   
+   for (size_t i = 0; i < Texts.size (); ++i) {
+      if (!Texts [i].empty ()) {
+         Text.Sections [(int) Owners [i]] += Texts [i] + "\n";
+      }
+   }
+   
+   return Text;
+}
+
+std::vector<std::string> Screen::ReadStrips (
+   const cv::Mat& Binary, 
+   const std::vector<cv::Range>& Strips, 
+   tesseract::PageSegMode PageMode, 
+   bool UseGlyphs, 
+   const std::function<bool ()>& Cancelled, 
+   const TextScale& Scale
+) 
+{
+   std::vector<std::string> Texts (Strips.size ());
+   
+   std::mutex FailureLock;
+   std::exception_ptr Failure;
+   
+   // Strips spread over the work pool. Single lines also skip Tesseract's
+   // layout analysis, which is most of the time spent on a tall tooltip.
+   // Their stages are traced as part of the caller's scan.
+   uint64_t Scan = Trace::current ();
+   
+   Workers->ParallelFor (0, (int) Strips.size (), [ & ] (int i) {
+      Trace::Scope Traced (Scan);
+      
+      if (Cancelled && Cancelled ()) {
+         return;
+      }
+      
+      try {
+         cv::Mat Strip = Binary.rowRange (Strips [i]);
+         
+         if (UseGlyphs) {
+            if (std::optional<std::string> Text = Glyphs.Read (Strip)) {
+               Stats::count ("ocr.glyphs.lines");
+               Texts [i] = std::move (*Text);
+               return;
+            }
+            
+            Stats::count ("ocr.glyphs.fallbacks");
+         }
+         
+         // Glyphs match at the native size, only Tesseract reads the
+         // resampled strip.
+         TesseractPool::Lease Tesseract = Readers.Acquire ();
+         Texts [i] = RecognizeText (*Tesseract, Strip, PageMode, Cancelled, Scale);
+      } catch (...) {
+         std::lock_guard<std::mutex> Guard (FailureLock);
+         
+         if (!Failure) {
+            Failure = std::current_exception ();
+         }
+      }
+   });
+   
+   if (Failure) {
+      std::rethrow_exception (Failure);
+   }
+   
+   if (Cancelled && Cancelled ()) {
+      return std::vector<std::string> (Strips.size ());
+   }
+   
+   for (std::string& Text : Texts) {
+      Text.erase (Text.find_last_not_of (" \n") + 1);
+   }
+   
+   return Texts;
+}
+
+std::vector<std::pair<std::string, ReadBenchmark>> Screen::BenchmarkReadModes (const std::string& Directory) 
+{
+   struct Sample {
+      cv::Mat Image;
+      std::string Expected;
+   };
+   
+   std::vector<Sample> Samples;
+   
+   for (const auto& Entry : std::filesystem::directory_iterator (Directory)) {
+      std::string Extension = Entry.path ().extension ().string ();
+      std::transform (Extension.begin (), Extension.end (), Extension.begin (), ::tolower);
+      
+      if (Extension != ".png" && Extension != ".jpg" && Extension != ".jpeg" && Extension != ".bmp") {
+         continue;
+      }
+      
+      cv::Mat Image = cv::imread (Entry.path ().string (), cv::IMREAD_COLOR);
+      
+      if (Image.empty ()) {
+         continue;
+      }
+      
+      std::filesystem::path Truth = std::filesystem::path (Entry.path ()).replace_extension (".txt");
+      std::string Expected;
+      
+      if (std::filesystem::exists (Truth)) {
+         std::ifstream Stream (Truth, std::ios::binary);
+         Expected.assign ((std::istreambuf_iterator<char> (Stream)), std::istreambuf_iterator<char> ());
+      } else {
+         Expected = Read (Image, ReadMode::Block);
+      }
+      
+      Samples.push_back ({ Image, NormalizeText (Expected) });
+   }
+   
+   typedef std::function<std::string (const cv::Mat&)> Reader;
+   
+   auto ReadAs = [ & ] (ReadMode Mode) -> Reader {
+      return [ this, Mode ] (const cv::Mat& Image) { return Read (Image, Mode); };
+   };
+   
+   auto ReadNative = [ & ] (ReadMode Mode) -> Reader {
+      return [ this, Mode ] (const cv::Mat& Image) { return ReadBinary (Preprocess (Image), Mode, nullptr, TextScale ()); };
+   };
+   
+   std::vector<std::pair<std::string, Reader>> Modes = {
+      { "block", ReadAs (ReadMode::Block) },
+      { "block.native", ReadNative (ReadMode::Block) },
+      
+      // The block mode on the OpenCV preprocessing the fused kernel replaced.
+      { "block.opencv", [ this ] (const cv::Mat& Image) {
+         cv::Mat Binary;
+         BinarizeTooltipReference (Image, Binary);
+         
+         return ReadBinary (Binary, ReadMode::Block, nullptr, ScaleText (Binary));
+      } },
+      
+      { "lines", ReadAs (ReadMode::Lines) },
+      { "lines.native", ReadNative (ReadMode::Lines) }
+   };
+   
+   if (!Glyphs.Empty ()) {
+      Modes.push_back ({ "glyphs", ReadAs (ReadMode::Glyphs) });
+   }
+   
+   std::vector<std::pair<std::string, ReadBenchmark>> Results;
+   
+   if (Samples.empty ()) {
+      return Results;
+   }
+   
+   auto Percentile = [] (std::vector<double>& Latencies, double P) {
+      std::sort (Latencies.begin (), Latencies.end ());
+      
+      size_t Index = (size_t) std::ceil (P * Latencies.size ()) - 1;
+      return Latencies [std::min (Index, Latencies.size () - 1)];
+   };
+   
+   for (const auto& [ Name, ReadText ] : Modes) {
+      size_t Errors = 0;
+      size_t Characters = 0;
+      
+      std::vector<double> Latencies;
+      
+      for (const Sample& Crop : Samples) {
+         auto Start = std::chrono::steady_clock::now ();
+         
+         std::string Text = ReadText (Crop.Image);
+         
+         std::chrono::duration<double, std::milli> Elapsed = std::chrono::steady_clock::now () - Start;
+         Latencies.push_back (Elapsed.count ());
+         
+         Errors += EditDistance (Crop.Expected, NormalizeText (Text));
+         Characters += Crop.Expected.size ();
+      }
+      
+      Results.emplace_back (Name, ReadBenchmark {
+         Characters ? (double) Errors / Characters : 0.0,
+         Percentile (Latencies, 0.50), 
+         Percentile (Latencies, 0.99)
+      });
+   }
+   
+   // Preprocessing alone, the error rate is the fraction of binary pixels
+   // that differ from the OpenCV preprocessing.
+   typedef void (*Binarizer) (const cv::Mat&, cv::Mat&);
+   
+   std::vector<std::pair<std::string, Binarizer>> Preprocessors = {
+      { "preprocess.fused", BinarizeTooltip },
+      { "preprocess.opencv", BinarizeTooltipReference }
+   };
+   
+   for (const auto& [ Name, Binarize ] : Preprocessors) {
+      size_t Different = 0;
+      size_t Pixels = 0;
+      
+      std::vector<double> Latencies;
+      
+      for (const Sample& Crop : Samples) {
+         cv::Mat Binary;
+         cv::Mat Reference;
+         
+         auto Start = std::chrono::steady_clock::now ();
+         
+         Binarize (Crop.Image, Binary);
+         
+         std::chrono::duration<double, std::milli> Elapsed = std::chrono::steady_clock::now () - Start;
+         Latencies.push_back (Elapsed.count ());
+         
+         BinarizeTooltipReference (Crop.Image, Reference);
+         
+         if (Binary.empty () || Binary.size () != Reference.size ()) {
+            continue;
+         }
+         
+         cv::Mat Mismatch;
+         cv::compare (Binary, Reference, Mismatch, cv::CMP_NE);
+         
+         Different += cv::countNonZero (Mismatch);
+         Pixels += Reference.total ();
+      }
+      
+      Results.emplace_back (Name, ReadBenchmark {
+         Pixels ? (double) Different / Pixels : 0.0,
+         Percentile (Latencies, 0.50), 
+         Percentile (Latencies, 0.99)
+      });
+   }
+   
+   return Results;
+}
+
+std::vector<Screen::ModelCandidate> Screen::ModelCandidates () 
+{
+   std::vector<ModelCandidate> Candidates;
+   
+   std::filesystem::path Base (OnnxFile);
+   
+   auto Add = [ & ] (const std::filesystem::path& File, int Size) {
+      if (UseQuantizedModel) {
+         std::filesystem::path Quantized = std::filesystem::path (File).replace_extension (".int8.onnx");
+         
+         if (std::filesystem::exists (Quantized)) {
+            Candidates.push_back ({ Quantized.string (), Size });
+         }
+      }
+      
+      if (File == Base || std::filesystem::exists (File)) {
+         Candidates.push_back ({ File.string (), Size });
+      }
+   };
+   
+   if (InputSize != DEFAULT_INPUT_SIZE) {
+      std::filesystem::path Sized = Base;
+      Sized.replace_filename (Base.stem ().string () + "-" + std::to_string (InputSize) + ".onnx");
+      
+      Add (Sized, InputSize);
+      
+      // Exports with dynamic axes run at any input size.
+      Add (Base, InputSize);
+   }
+   
+   Add (Base, DEFAULT_INPUT_SIZE);
+   
+   return Candidates;
+}
+
+std::unique_ptr<InferenceEngine> Screen::LoadInferenceEngine (const std::string& File) 
+{
+   std::vector<std::string> Candidates = { EngineName };
+   
+   if (EngineName == "auto") {
+      Candidates = AvailableInferenceEngines ();
+   } else if (!CreateInferenceEngine (EngineName)) {
+      Logger::log (
+         Logger::Level::E_WARNING,
+         "Inference engine " + EngineName + " is not available in this build, using opencv"
+      );
+      
+      Candidates = { "opencv" };
+   }
+   
+   std::unique_ptr<InferenceEngine> Best;
+   double BestMedian = 0;
+   
+   for (const std::string& Name : Candidates) {
+      std::unique_ptr<InferenceEngine> Candidate = CreateInferenceEngine (Name);
+      
+      if (!Candidate->Load (File)) {
+         Logger::log (
+            Logger::Level::E_WARNING,
+            "Inference engine " + Name + " failed to load " + File
+         );
+         
+         continue;
+      }
+      
+      InferenceBenchmark Result;
+      
+      // Running the model also verifies it accepts the input size, exports
+      // with fixed axes only fail once they run.
+      try {
+         Result = BenchmarkInferenceEngine (
+            *Candidate, 
+            InputWidth, 
+            InputHeight, 
+            Candidates.size () == 1 ? 1 : ENGINE_BENCHMARK_RUNS
+         );
+      } catch (const std::exception& E) {
+         Logger::log (
+            Logger::Level::E_WARNING,
+            "Inference engine " + Name + " failed to run " + File + ": " + E.what ()
+         );
+         
+         continue;
+      }
+      
+      // Nothing to compare against when only one engine was requested.
+      if (Candidates.size () == 1) {
+         return Candidate;
+      }
+      
+      Logger::log (
+         Logger::Level::E_INFO,
+         "Inference engine " + Name + 
+         ": p50 " + std::to_string (Result.Median) + "ms" +
+         ", p99 " + std::to_string (Result.P99) + "ms"
+      );
+      
+      if (!Best || Result.Median < BestMedian) {
+         Best = std::move (Candidate);
+         BestMedian = Result.Median;
+      }
+   }
+   
+   if (Best) {
+      Logger::log (
+         Logger::Level::E_INFO,
+         "Using inference engine " + Best->Name ()
+      );
+   }
+   
+   return Best;
+}
+
+std::vector<std::pair<std::string, StageBenchmark>> Screen::BenchmarkDetector (int Runs, const std::string& Directory) 
+{
+   std::vector<cv::Mat> Sources;
+   
+   if (!Directory.empty ()) {
+      for (const auto& Entry : std::filesystem::directory_iterator (Directory)) {
+         std::string Extension = Entry.path ().extension ().string ();
+         std::transform (Extension.begin (), Extension.end (), Extension.begin (), ::tolower);
+         
+         if (Extension != ".png" && Extension != ".jpg" && Extension != ".jpeg" && Extension != ".bmp") {
+            continue;
+         }
+         
+         cv::Mat Image = cv::imread (Entry.path ().string (), cv::IMREAD_COLOR);
+         
+         if (!Image.empty ()) {
+            Sources.push_back (Image);
+         }
+      }
+   }
+   
+   // Dark boxes on noise, so the resize sees both edges and flat areas.
+   if (Sources.empty ()) {
+      cv::Mat Generated (2160, 3840, CV_8UC3);
+      cv::RNG Random (0x5EED);
+      
+      Random.fill (Generated, cv::RNG::UNIFORM, 0, 256);
+      
+      for (int i = 0; i < 12; ++i) {
+         cv::Rect Box (Random.uniform (0, 3400), Random.uniform (0, 1700), Random.uniform (200, 440), Random.uniform (150, 460));
+         cv::rectangle (Generated, Box, cv::Scalar::all (Random.uniform (0, 60)), cv::FILLED);
+      }
+      
+      Sources.push_back (Generated);
+   }
+   
+   struct Resolution {
+      std::string Name;
+      cv::Size Size;
+   };
+   
+   std::vector<Resolution> Resolutions = {
+      { "1080p", cv::Size (1920, 1080) },
+      { "1440p", cv::Size (2560, 1440) },
+      { "4k", cv::Size (3840, 2160) }
+   };
+   
+   auto Percentile = [] (std::vector<double>& Latencies, double P) {
+      std::sort (Latencies.begin (), Latencies.end ());
+      
+      size_t Index = (size_t) std::ceil (P * Latencies.size ()) - 1;
+      return Latencies [std::min (Index, Latencies.size () - 1)];
+   };
+   
+   typedef void (*Letterbox) (const cv::Mat&, cv::Mat&, int, int);
+   
+   std::vector<std::pair<std::string, Letterbox>> Letterboxes = {
+      { "letterbox.fused", LetterboxBlob },
+      { "letterbox.opencv", LetterboxBlobReference }
+   };
+   
+   std::vector<std::pair<std::string, StageBenchmark>> Results;
+   
+   Runs = std::max (1, Runs);
+   
+   // Boxes of A that B did not keep.
+   auto Unmatched = [] (const std::vector<Detection>& A, const std::vector<Detection>& B) {
+      size_t Count = 0;
+      
+      for (const Detection& Each : A) {
+         bool Found = std::any_of (B.begin (), B.end (), [ & ] (const Detection& Other) {
+            return Other.Box == Each.Box;
+         });
+         
+         Count += Found ? 0 : 1;
+      }
+      
+      return Count;
+   };
+   
+   auto CompareDecoders = [ & ] (const std::string& Suffix, const std::vector<cv::Mat>& Outputs, float XScale, float YScale) {
+      YoloDecoder Fused;
+      
+      size_t Different = 0;
+      
+      std::vector<double> FusedLatencies;
+      std::vector<double> ReferenceLatencies;
+      
+      for (const cv::Mat& Output : Outputs) {
+         std::vector<Detection> Kept;
+         std::vector<Detection> Expected;
+         
+         for (int i = 0; i < Runs; ++i) {
+            auto Start = std::chrono::steady_clock::now ();
+            
+            Fused.Decode (Output, (float) MINIMUM_OBJECT_CONFIDENCE, XScale, YScale);
+            Kept = Fused.Suppress ((float) NMS_SCORE_THRESHOLD, (float) NMS_THRESHOLD);
+            
+            auto Middle = std::chrono::steady_clock::now ();
+            
+            Expected = DecodeReference (
+               Output, 
+               (float) MINIMUM_OBJECT_CONFIDENCE, 
+               XScale, 
+               YScale, 
+               (float) NMS_SCORE_THRESHOLD, 
+               (float) NMS_THRESHOLD
+            );
+            
+            auto End = std::chrono::steady_clock::now ();
+            
+            FusedLatencies.push_back (std::chrono::duration<double, std::milli> (Middle - Start).count ());
+            ReferenceLatencies.push_back (std::chrono::duration<double, std::milli> (End - Middle).count ());
+         }
+         
+         Different += Unmatched (Kept, Expected) + Unmatched (Expected, Kept);
+      }
+      
+      Results.emplace_back ("decode.fused." + Suffix, StageBenchmark {
+         (double) Different,
+         Percentile (FusedLatencies, 0.50), 
+         Percentile (FusedLatencies, 0.99)
+      });
+      
+      Results.emplace_back ("decode.opencv." + Suffix, StageBenchmark {
+         0.0,
+         Percentile (ReferenceLatencies, 0.50), 
+         Percentile (ReferenceLatencies, 0.99)
+      });
+   };
+   
+   // The border detector against the model it stands in for, on the same
+   // frames. The model's boxes count as the truth, a frame is one of them
+   // when they overlap by half. Every frame the detector keeps is counted,
+   // a scan only uses them when the cursor is on one.
+   auto CompareBorders = [ & ] (const std::string& Suffix, const std::vector<cv::Mat>& Frames, float XScale, float YScale) {
+      BorderDetector Detector;
+      YoloDecoder Model;
+      
+      // Over all frames: the model's boxes and how many of them a frame
+      // matches, the detector's frames and how many of them a box matches.
+      size_t Truths = 0;
+      size_t Recalled = 0;
+      size_t Framed = 0;
+      size_t Confirmed = 0;
+      
+      std::vector<double> BorderLatencies;
+      std::vector<double> ModelLatencies;
+      
+      auto Matches = [] (const std::vector<cv::Rect>& A, const std::vector<cv::Rect>& B) {
+         return (size_t) std::count_if (A.begin (), A.end (), [ & ] (const cv::Rect& Box) {
+            return std::any_of (B.begin (), B.end (), [ & ] (const cv::Rect& Other) {
+               return Overlap (Box, Other) >= 0.5;
+            });
+         });
+      };
+      
+      for (const cv::Mat& Frame : Frames) {
+         std::vector<cv::Rect> Found;
+         std::vector<cv::Rect> Truth;
+         
+         for (int i = 0; i < Runs; ++i) {
+            auto Start = std::chrono::steady_clock::now ();
+            
+            const std::vector<BorderDetector::Frame>& Detected = Detector.Detect (Frame);
+            
+            BorderLatencies.push_back (std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - Start).count ());
+            
+            Found.clear ();
+            
+            for (const BorderDetector::Frame& Tooltip : Detected) {
+               Found.push_back (Tooltip.Box);
+            }
+         }
+         
+         // Letterbox, inference and decode, everything the detector saves
+         // when it finds the frame.
+         for (int i = 0; i < Runs; ++i) {
+            std::lock_guard<std::mutex> Lock (DNNLock);
+            
+            auto Start = std::chrono::steady_clock::now ();
+            
+            cv::Mat Input;
+            LetterboxBlob (Frame, Input, InputWidth, InputHeight);
+            
+            Model.Decode (Engine->Run (Input), (float) MINIMUM_OBJECT_CONFIDENCE, XScale, YScale);
+            const std::vector<Detection>& Kept = Model.Suppress ((float) NMS_SCORE_THRESHOLD, (float) NMS_THRESHOLD);
+            
+            ModelLatencies.push_back (std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - Start).count ());
+            
+            Truth.clear ();
+            
+            for (const Detection& Tooltip : Kept) {
+               Truth.push_back (Tooltip.Box);
+            }
+         }
+         
+         Truths += Truth.size ();
+         Recalled += Matches (Truth, Found);
+         Framed += Found.size ();
+         Confirmed += Matches (Found, Truth);
+      }
+      
+      // Difference counts the boxes only one of the two found.
+      StageBenchmark Borders {
+         (double) ((Truths - Recalled) + (Framed - Confirmed)),
+         Percentile (BorderLatencies, 0.50), 
+         Percentile (BorderLatencies, 0.99)
+      };
+      
+      if (Truths > 0) {
+         Borders.Recall = (double) Recalled / Truths;
+      }
+      
+      if (Framed > 0) {
+         Borders.Precision = (double) Confirmed / Framed;
+      }
+      
+      Results.emplace_back ("detect.borders." + Suffix, Borders);
+      
+      Results.emplace_back ("detect.model." + Suffix, StageBenchmark {
+         0.0,
+         Percentile (ModelLatencies, 0.50), 
+         Percentile (ModelLatencies, 0.99)
+      });
+   };
+   
+   for (const Resolution& Each : Resolutions) {
+      // Captures arrive as BGRA.
+      std::vector<cv::Mat> Frames;
+      
+      for (const cv::Mat& Source : Sources) {
+         cv::Mat Scaled;
+         cv::Mat Frame;
+         
+         cv::resize (Source, Scaled, Each.Size, 0, 0, cv::INTER_AREA);
+         cv::cvtColor (Scaled, Frame, cv::COLOR_BGR2BGRA);
+         
+         Frames.push_back (Frame);
+      }
+      
+      for (const auto& [ Name, Build ] : Letterboxes) {
+         double Difference = 0;
+         std::vector<double> Latencies;
+         
+         cv::Mat Built;
+         cv::Mat Reference;
+         
+         for (const cv::Mat& Frame : Frames) {
+            for (int i = 0; i < Runs; ++i) {
+               auto Start = std::chrono::steady_clock::now ();
+               
+               Build (Frame, Built, InputWidth, InputHeight);
+               
+               std::chrono::duration<double, std::milli> Elapsed = std::chrono::steady_clock::now () - Start;
+               Latencies.push_back (Elapsed.count ());
+            }
+            
+            LetterboxBlobReference (Frame, Reference, InputWidth, InputHeight);
+            Difference = std::max (Difference, cv::norm (Built, Reference, cv::NORM_INF));
+         }
+         
+         Results.emplace_back (Name + "." + Each.Name, StageBenchmark {
+            Difference,
+            Percentile (Latencies, 0.50), 
+            Percentile (Latencies, 0.99)
+         });
+      }
+      
+      if (!Engine) {
+         continue;
+      }
+      
+      // The model's outputs for these frames, which may point into engine
+      // memory until copied.
+      std::vector<cv::Mat> Outputs;
+      
+      {
+         std::lock_guard<std::mutex> Lock (DNNLock);
+         
+         for (const cv::Mat& Frame : Frames) {
+            cv::Mat Input;
+            LetterboxBlobReference (Frame, Input, InputWidth, InputHeight);
+            
+            Outputs.push_back (Engine->Run (Input).clone ());
+         }
+      }
+      
+      int Max = std::max (Each.Size.width, Each.Size.height);
+      
+      CompareDecoders (Each.Name, Outputs, (float) Max / InputWidth, (float) Max / InputHeight);
+      
+      CompareBorders (Each.Name, Frames, (float) Max / InputWidth, (float) Max / InputHeight);
+   }
+   
+   // Real outputs rarely hold more than a few boxes above the confidence
+   // threshold. This one has clusters of overlapping boxes for suppression
+   // to work through.
+   int Anchors = (InputWidth / 8) * (InputHeight / 8) + (InputWidth / 16) * (InputHeight / 16) + (InputWidth / 32) * (InputHeight / 32);
+   int Dimensions = 4 + (int) MODEL_OBJECTS.size ();
+   
+   cv::Mat Generated (std::vector<int> { 1, Dimensions, Anchors }, CV_32F, cv::Scalar (0));
+   cv::RNG Random (0xB0C5);
+   
+   float* Data = Generated.ptr<float> ();
+   
+   for (int Anchor = 0; Anchor < Anchors; ++Anchor) {
+      for (int Class = 0; Class < (int) MODEL_OBJECTS.size (); ++Class) {
+         Data [(4 + Class) * Anchors + Anchor] = Random.uniform (0.0f, 0.5f);
+      }
+   }
+   
+   for (int Cluster = 0; Cluster < 40; ++Cluster) {
+      float X = Random.uniform (0.0f, (float) InputWidth);
+      float Y = Random.uniform (0.0f, (float) InputHeight);
+      float W = Random.uniform (20.0f, 160.0f);
+      float H = Random.uniform (20.0f, 200.0f);
+      
+      for (int Box = 0; Box < 25; ++Box) {
+         int Anchor = Random.uniform (0, Anchors);
+         
+         Data [Anchor] = X + Random.uniform (-0.2f, 0.2f) * W;
+         Data [Anchors + Anchor] = Y + Random.uniform (-0.2f, 0.2f) * H;
+         Data [2 * Anchors + Anchor] = W * Random.uniform (0.8f, 1.2f);
+         Data [3 * Anchors + Anchor] = H * Random.uniform (0.8f, 1.2f);
+         Data [4 * Anchors + Anchor] = Random.uniform (0.9f, 1.0f);
+      }
+   }
+   
+   CompareDecoders ("generated", { Generated }, 1.0f, 1.0f);
+   
+   return Results;
+}
+
+std::vector<std::pair<std::string, InferenceBenchmark>> Screen::BenchmarkInferenceEngines (int Runs) 
+{
+   std::vector<std::pair<std::string, InferenceBenchmark>> Results;
+   
+   for (const std::string& Name : AvailableInferenceEngines ()) {
+      std::unique_ptr<InferenceEngine> Candidate = CreateInferenceEngine (Name);
+      
+      if (!Candidate->Load (ModelFile)) {
+         continue;
+      }
+      
+      Results.emplace_back (Name, BenchmarkInferenceEngine (
+         *Candidate, 
+         InputWidth, 
+         InputHeight, 
+         Runs
+      ));
+   }
+   
+   return Results;
+}
+
+std::optional<Screen::Reading> Screen::Recall (const cv::Mat& Screenshot) 
+{
+   std::lock_guard<std::mutex> Lock (RecallLock);
+   
+   if (!LastReading || !LastTiles.Matches (Screenshot)) {
+      Stats::count ("cache.tiles.misses");
+      return std::nullopt;
+   }
+   
+   Stats::count ("cache.tiles.hits");
+   return LastReading;
+}
+
+void Screen::Remember (const cv::Mat& Screenshot, const Reading& Result) 
+{
+   std::lock_guard<std::mutex> Lock (RecallLock);
+   
+   LastTiles.Compute (Screenshot, Result.Tooltip);
+   LastReading = Result;
+   
+   Tracker.Reset (Screenshot, Result.Tooltip);
+}
+
+std::optional<cv::Rect> Screen::Track (const cv::Mat& Screenshot) 
+{
+   std::lock_guard<std::mutex> Lock (RecallLock);
+   
+   if (Tracker.Empty ()) {
+      return std::nullopt;
+   }
+   
+   std::optional<cv::Rect> Tooltip = Tracker.Track (Screenshot);
+   
+   Stats::count (Tooltip ? "tracker.hits" : "tracker.misses");
+   
+   return Tooltip;
+}
+
+bool Screen::InitializeScreenCaptureLite () 
+{
+   Logger::log (
+      Logger::Level::E_INFO,
+      "Initializing Screen Capture Lite"
+   );
+
+   auto GetMonitorsCallback = [] () {
+      auto Monitors = SL::Screen_Capture::GetMonitors ();
+      
+      for (const auto& M : Monitors) {
+         Logger::log (
+            Logger::Level::E_INFO,
+            "Monitor " + std::to_string (M.Id) + 
+            ": " + std::to_string (M.Width) + 
+            "x" + std::to_string (M.Height) +
+            " (Original: " + std::to_string (M.OriginalWidth) + "x" + std::to_string (M.OriginalHeight) + ") " +
+            "at (" + std::to_string (M.OffsetX) + "," + std::to_string (M.OffsetY) + ") " +
+            "Scaling: " + std::to_string (M.Scaling)
+         );
+      }
+
+      return Monitors;
+   };
+
+   auto Config = SL::Screen_Capture::CreateCaptureConfiguration (GetMonitorsCallback);
+
+   Config->onNewFrame ([ this ] (const SL::Screen_Capture::Image& Img, const SL::Screen_Capture::Monitor& Monitor) {
+      // Logger::log (
+      //    Logger::Level::E_DEBUG,
+      //    "ScreenCaptureLite callback triggered for monitor " + std::to_string(Monitor.Id)
+      // );
+      
+      std::optional<int> CurrentGameMonitorId = GetGameMonitorId ();
+
+      if (!CurrentGameMonitorId.has_value () || CurrentGameMonitorId.value () == Monitor.Id) {
+         int Height = SL::Screen_Capture::Height (Img);
+         int Width = SL::Screen_Capture::Width (Img);
          
          int TargetWidth = Monitor.OriginalWidth;
          int TargetHeight = Monitor.OriginalHeight;
@@ -531,25 +1676,17 @@ bool Screen::InitializeScreenCaptureLite ()
          //    ", scaling factor: " + std::to_string (Monitor.Scaling)
          // );
          
-         // 4 bytes per pixel (BGRA)
-         std::vector<uint8_t> Buffer (Width * Height * 4); 
+         // Extract straight into a pooled buffer, it is shared from here on
+         // without any further copies.
+         std::shared_ptr<Frame> Captured = Frames->Acquire (Width, Height);
          
          SL::Screen_Capture::Extract (
             Img, 
-            Buffer.data (), 
-            Buffer.size ()
-         );
-
-         cv::Mat Frame (
-            Height, 
-            Width, 
-            CV_8UC4, 
-            Buffer.data ()
+            Captured->Buffer.data (), 
+            Captured->Buffer.size ()
          );
          
-         std::lock_guard<std::mutex> Lock (FrameMutex);
-         LatestFrame = Frame.clone ();
-         HasNewFrame = true;
+         LatestFrame.Publish (std::move (Captured));
       }
    });
 
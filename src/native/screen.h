@@ -1,13 +1,23 @@
 #pragma once
 
+#include "border.h"
+#include "cache.h"
+#include "decode.h"
+#include "frame.h"
+#include "glyph.h"
+#include "inference.h"
+#include "ocr.h"
+#include "pool.h"
+#include "tiles.h"
+#include "tracker.h"
 #include "wgc.h"
+#include <array>
 #include <atomic>
 #include <mutex>
 #include <opencv2/dnn.hpp>
 #include <opencv2/core/mat.hpp>
 #include <opencv2/imgproc.hpp>
 #include <optional>
-#include <tesseract/baseapi.h>
 #include <vector>
 #include <memory>
 #include <chrono>
@@ -28,17 +38,153 @@ class Screen
 {
    public:
    
+   // Cursor position in screenshot coordinates and the distance from it that
+   // the game is expected to draw the hovered item's tooltip within.
+   struct Cursor {
+      int X;
+      int Y;
+      int Radius;
+   };
+   
+   // How tooltip text is read. Glyphs reads lines like Lines, but tries the
+   // glyph templates before Tesseract.
+   enum class ReadMode {
+      Block,
+      Lines,
+      Glyphs
+   };
+   
+   // A tooltip and the text read from it.
+   struct Reading {
+      cv::Rect Tooltip;
+      TooltipText Text;
+   };
+   
    static std::string TesseractPath;
    static std::string OnnxFile;
    
+   // Which inference engine runs the model, "auto" benchmarks all of them
+   static std::string EngineName;
+   
+   // Whether to load the INT8 model ("<model>.int8.onnx") when it exists
+   static bool UseQuantizedModel;
+   
+   // Requested detector input size, the default size is used when no export
+   // can run at it
+   static int InputSize;
+   
+   // Whether to look for tooltip frames with the border detector before
+   // running the model
+   static bool UseBorderDetector;
+   
+   // Whether to read tooltips line by line instead of as a single block
+   static bool UseLineSegmentation;
+   
+   // Whether to read lines with glyph templates rendered from FontFiles,
+   // Tesseract still reads the lines they are not sure about
+   static bool UseGlyphReader;
+   static std::vector<std::string> FontFiles;
+   
+   // Memory bound of the cache of read tooltip texts, zero disables it
+   static size_t ReadCacheBytes;
+   
+   // Pixels tooltip text is resampled to between its baseline and the top of
+   // lower case letters before Tesseract reads it, zero reads it at the
+   // native size
+   static int OcrXHeight;
+   
+   // Which tooltip sections are read, indexed by Section. The header is always
+   // read, it identifies the item
+   static SectionSet EnabledSections;
+   
+   // Whether getTooltip resolves once the header is read and reads the other
+   // sections in a follow-up
+   static bool UseTwoPhaseRead;
+   
    ~Screen ();
    Screen ();
    
    bool Initialize ();
-   std::optional<cv::Mat> Capture ();
+   FrameRef Capture ();
+   
+   // Threads that run scans and the reads within them, kept from the first
+   // initialization until the screen is destroyed.
+   WorkPool& Pool ();
+   
+   // Finds tooltips in the screenshot. Boxes overlapping one of Excluded, the
+   // tooltips the overlay itself draws, are dropped before anything reads
+   // them. Excluded and Position are in screenshot coordinates for both.
+   // The detections keep the model's confidence. Frames of the border
+   // detector are only used when one is at Position, their confidence is the
+   // share of their sides that matched the frame art.
+   std::optional<std::vector<Detection>> FindTooltips (const cv::Mat& Screenshot, const std::vector<cv::Rect>& Excluded = {}, const std::optional<Cursor>& Position = std::nullopt);
+   std::optional<std::vector<Detection>> FindTooltipsNear (const cv::Mat& Screenshot, const Cursor& Position, const std::vector<cv::Rect>& Excluded = {});
+   
+   // Orders tooltips from the most to the least likely to be the hovered
+   // item's. Their confidence is weighed by how far they are from the cursor
+   // and whether the cursor is level with them.
+   void Rank (std::vector<Detection>& Tooltips, const Cursor& Position);
+   
+   // Finds the tooltips of a scan: the tracked one while it is still on
+   // screen, else those around the cursor, else those in the whole frame.
+   // They are ranked when there is a cursor.
+   std::optional<std::vector<cv::Rect>> Locate (const cv::Mat& Screenshot, const std::optional<Cursor>& Position, const std::vector<cv::Rect>& Excluded = {});
+   
+   // Reads Parts of the ranked Tooltips, best ranked first, and returns the
+   // best ranked one with an acceptable text. Returns nothing when none has
+   // one and rethrows the first failed read when that is why. The number of
+   // reads is sampled as scan.ocr_calls. Once Stale returns true no further
+   // candidate is read and the reads under way are abandoned, each counted
+   // as scan.stale.ocr.
+   std::optional<Reading> ReadBest (const cv::Mat& Screenshot, const std::vector<cv::Rect>& Tooltips, const SectionSet& Parts, const std::function<bool ()>& Stale = nullptr);
+   
+   // Reads the text of a tooltip on one of the pooled Tesseract instances.
+   // Cancelled is polled while reading, once it returns true the read is
+   // abandoned and returns empty text. Without a mode the configured one is
+   // used to read Parts, or the EnabledSections, and tooltips of which all
+   // EnabledSections were read before come whole from the cache. With a mode
+   // the whole tooltip is read.
+   TooltipText Read (const cv::Mat& Region, const std::function<bool ()>& Cancelled = nullptr);
+   TooltipText Read (const cv::Mat& Region, const SectionSet& Parts, const std::function<bool ()>& Cancelled = nullptr);
+   std::string Read (const cv::Mat& Region, ReadMode Mode, const std::function<bool ()>& Cancelled = nullptr);
    
-   std::optional<std::vector<cv::Rect>> FindTooltips (cv::Mat Screenshot);
-   std::string Read (cv::Mat Region);
+   // Caches the text of a tooltip that was read in several parts, and updates
+   // the remembered reading when it still is of Tooltip.
+   void Complete (const cv::Mat& Region, const cv::Rect& Tooltip, const TooltipText& Text);
+   
+   // Reads every tooltip crop in Directory in each read mode and compares
+   // the result with the expected text in a .txt file next to the crop. The
+   // block mode result is expected for crops without one. The block.opencv
+   // entry reads with the previous OpenCV preprocessing, the preprocess
+   // entries time the preprocessing alone and report the fraction of pixels
+   // that differ from it as their error rate. The native entries read without
+   // resampling the text to OcrXHeight.
+   std::vector<std::pair<std::string, ReadBenchmark>> BenchmarkReadModes (const std::string& Directory);
+   
+   // Loads a separate instance of every available inference engine and times
+   // it on the detector input size.
+   std::vector<std::pair<std::string, InferenceBenchmark>> BenchmarkInferenceEngines (int Runs);
+   
+   // Times the reimplemented detector stages against the OpenCV paths they
+   // replaced on 1080p, 1440p and 4K captures, Runs times per frame. The
+   // frames are the screenshots in Directory scaled to each size, or a
+   // generated one when it is empty or has none. The letterbox entries
+   // report the largest absolute difference of an input tensor value from
+   // the OpenCV one. The decode entries decode the model's output on those
+   // frames, and a generated output of many overlapping boxes, and report
+   // how many boxes only one of the two paths kept. The border detector is
+   // timed against the whole model pass on the same frames, with the recall
+   // and precision of its frames against the model's boxes.
+   std::vector<std::pair<std::string, StageBenchmark>> BenchmarkDetector (int Runs, const std::string& Directory);
+   
+   // Returns the last remembered reading when none of the screen tiles under
+   // its tooltip changed since, so the scan can skip detection and OCR.
+   std::optional<Reading> Recall (const cv::Mat& Screenshot);
+   void Remember (const cv::Mat& Screenshot, const Reading& Result);
+   
+   // Returns where the last remembered tooltip moved to when it is still on
+   // screen, without running the detector.
+   std::optional<cv::Rect> Track (const cv::Mat& Screenshot);
    
    private:
    
@@ -49,23 +195,59 @@ class Screen
 
    const std::vector<std::string> MODEL_OBJECTS = { "Tooltip" };
    
-   const float MODEL_WIDTH = 640;
-   const float MODEL_HEIGHT = 640;
+   // Input size of the main model export, exports for other sizes are named
+   // "<model>-<size>.onnx"
+   const int DEFAULT_INPUT_SIZE = 640;
    
    const double MINIMUM_OBJECT_CONFIDENCE = 0.90;
    
+   // Timed inferences per engine when picking one automatically
+   const int ENGINE_BENCHMARK_RUNS = 10;
+   
    const double NMS_SCORE_THRESHOLD = 0.45;
    const double NMS_THRESHOLD = 0.50;
    
+   // Upper bound of the Tesseract pool size, the rest of the cores are left
+   // to inference and the game.
+   const int MAXIMUM_TESSERACT_INSTANCES = 4;
+   
+   // Tooltips found within this many pixels of the edge of a cursor region
+   // may be cut off by it.
+   const int REGION_EDGE_MARGIN = 4;
+   
+   // Boxes with at least this intersection over union with a tooltip of the
+   // overlay are that tooltip.
+   const double OVERLAY_OVERLAP = 0.5;
+   
+   // Fraction of the cursor radius over which a tooltip's rank falls to 1/e
+   // of its confidence.
+   const double RANK_DISTANCE_FALLOFF = 0.25;
+   
+   // Rank factor of tooltips the cursor is above or below.
+   const double RANK_OFF_SIDE = 0.75;
+   
    std::atomic<bool> IsInitialized;
    std::thread::id MainThreadId;
    
    std::mutex CaptureLock;
    std::mutex DNNLock;
-   std::mutex TesseractLock;
    
-   std::unique_ptr<cv::dnn::Net> Net;
-   std::unique_ptr<tesseract::TessBaseAPI> Tesseract;
+   std::unique_ptr<InferenceEngine> Engine;
+   std::string ModelFile;
+   
+   // Input size of the loaded model
+   int InputWidth = 640;
+   int InputHeight = 640;
+   
+   // Detector input tensor, output decoder and border detector, reused
+   // between scans and guarded by DNNLock
+   cv::Mat Blob;
+   YoloDecoder Decoder;
+   BorderDetector Borders;
+   TesseractPool Readers;
+   std::unique_ptr<WorkPool> Workers;
+   GlyphReader Glyphs;
+   TextCache ReadCache;
    
    // Capture method selection
    CaptureMethod CurrentCaptureMethod;
@@ -75,11 +257,47 @@ class Screen
    
    std::unique_ptr<WindowsGraphicsCapture> WGCInstance;
    
-   // Common capture data
-   cv::Mat LatestFrame;
-   cv::Mat BackupFrame;  // Backup frame for when no new frame is available
-   std::mutex FrameMutex;
-   std::atomic<bool> HasNewFrame = false;
+   // Common capture data, the last published frame doubles as the backup
+   // frame for when no new frame is available
+   std::shared_ptr<FramePool> Frames;
+   FrameSlot LatestFrame;
+   
+   // Last successful reading, the tile hashes of the frame it came from and
+   // the tracker following its tooltip
+   std::mutex RecallLock;
+   std::optional<Reading> LastReading;
+   TileHashes LastTiles;
+   TooltipTracker Tracker;
+   
+   struct ModelCandidate {
+      std::string File;
+      int Size;
+   };
+   
+   std::vector<ModelCandidate> ModelCandidates ();
+   std::unique_ptr<InferenceEngine> LoadInferenceEngine (const std::string& File);
+   
+   std::optional<std::vector<Detection>> DetectTooltips (const cv::Mat& Screenshot, const std::optional<Cursor>& Position);
+   
+   // Whether a text can be the hovered item's: it has a header and is not
+   // the overlay's own tooltip.
+   static bool IsAcceptable (const TooltipText& Text);
+   
+   cv::Mat Preprocess (const cv::Mat& Region);
+   TextScale ScaleText (const cv::Mat& Binary);
+   std::string ReadBinary (const cv::Mat& Binary, ReadMode Mode, const std::function<bool ()>& Cancelled, const TextScale& Scale);
+   TooltipText ReadSections (const cv::Mat& Binary, ReadMode Mode, const SectionSet& Parts, const std::function<bool ()>& Cancelled, const TextScale& Scale);
+   
+   // Reads every strip of rows of Binary at once on the pool and returns
+   // their texts without trailing blanks.
+   std::vector<std::string> ReadStrips (
+      const cv::Mat& Binary, 
+      const std::vector<cv::Range>& Strips, 
+      tesseract::PageSegMode PageMode, 
+      bool UseGlyphs, 
+      const std::function<bool ()>& Cancelled, 
+      const TextScale& Scale
+   );
    
    bool InitializeScreenCaptureLite ();
    bool InitializeWindowsGraphicsCapture ();
@@ -0,0 +1,265 @@
+#include "stats.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <vector>
+
+std::array<Stats::Slot, Stats::SLOT_COUNT> Stats::Slots;
+
+Stats::Timer::Timer (const char* Name) : Name (Name),
+   Start (std::chrono::steady_clock::now ())
+{
+}
+
+Stats::Timer::~Timer ()
+{
+   std::chrono::steady_clock::time_point End = std::chrono::steady_clock::now ();
+   std::chrono::duration<double, std::milli> Elapsed = End - Start;
+
+   Stats::time (Name, Elapsed.count ());
+   Trace::complete (Name, Start, End);
+}
+
+Stats::Entry::Entry (std::string_view Name, Kind Type) : Name (Name),
+   Type (Type),
+   Values (Type == Kind::Counter ? nullptr : std::make_unique<Histogram> ())
+{
+}
+
+void Stats::count (std::string_view Name, int64_t Amount)
+{
+   find (Name, Kind::Counter).Counter.fetch_add (Amount, std::memory_order_relaxed);
+}
+
+void Stats::time (std::string_view Name, double Milliseconds)
+{
+   // Kept in microseconds
+   find (Name, Kind::Timing).Values->record ((uint64_t) std::llround (std::max (Milliseconds, 0.0) * 1000.0));
+}
+
+void Stats::sample (std::string_view Name, double Value)
+{
+   find (Name, Kind::Sample).Values->record ((uint64_t) std::llround (std::max (Value, 0.0)));
+}
+
+Napi::Object Stats::snapshot (Napi::Env Env)
+{
+   std::vector<const Entry*> Entries;
+
+   for (const Slot& Each : Slots) {
+      if (const Entry* Found = Each.Value.load (std::memory_order_acquire)) {
+         Entries.push_back (Found);
+      }
+   }
+
+   std::sort (Entries.begin (), Entries.end (), [] (const Entry* A, const Entry* B) {
+      return A->Name < B->Name;
+   });
+
+   Napi::Object Counts = Napi::Object::New (Env);
+   Napi::Object Timings = Napi::Object::New (Env);
+   Napi::Object Samples = Napi::Object::New (Env);
+
+   for (const Entry* Each : Entries) {
+      if (Each->Type == Kind::Counter) {
+         Counts.Set (Each->Name, Napi::Number::New (Env, (double) Each->Counter.load (std::memory_order_relaxed)));
+         continue;
+      }
+
+      Histogram::Summary Summary = Each->Values->summarize ();
+
+      if (Summary.Count == 0) {
+         continue;
+      }
+
+      if (Each->Type == Kind::Timing) {
+         Timings.Set (Each->Name, summarize (Env, Summary, 0.001));
+      } else {
+         Samples.Set (Each->Name, summarize (Env, Summary, 1.0));
+      }
+   }
+
+   Napi::Object Result = Napi::Object::New (Env);
+
+   Result.Set ("counters", Counts);
+   Result.Set ("timings", Timings);
+   Result.Set ("samples", Samples);
+
+   return Result;
+}
+
+void Stats::reset ()
+{
+   for (Slot& Each : Slots) {
+      if (Entry* Found = Each.Value.load (std::memory_order_acquire)) {
+         Found->Counter.store (0, std::memory_order_relaxed);
+
+         if (Found->Values) {
+            Found->Values->reset ();
+         }
+      }
+   }
+}
+
+Stats::Entry& Stats::find (std::string_view Name, Kind Type)
+{
+   // Zero marks a free slot.
+   uint64_t Hash = ((uint64_t) std::hash<std::string_view> {} (Name) ^ ((uint64_t) Type + 1) * 0x9E3779B97F4A7C15ull) | 1;
+
+   for (size_t Probe = 0; Probe < SLOT_COUNT; ++Probe) {
+      Slot& Candidate = Slots [(Hash + Probe) % SLOT_COUNT];
+
+      uint64_t Claimed = Candidate.Hash.load (std::memory_order_acquire);
+
+      if (Claimed == 0 && Candidate.Hash.compare_exchange_strong (Claimed, Hash, std::memory_order_acq_rel)) {
+         // The only copy of the name, lookups compare against it in place.
+         Entry* Created = new Entry (Name, Type);
+         Candidate.Value.store (Created, std::memory_order_release);
+
+         return *Created;
+      }
+
+      if (Claimed != Hash) {
+         continue;
+      }
+
+      // The thread that claimed the slot may not have stored its entry yet.
+      Entry* Existing = Candidate.Value.load (std::memory_order_acquire);
+
+      while (!Existing) {
+         std::this_thread::yield ();
+         Existing = Candidate.Value.load (std::memory_order_acquire);
+      }
+
+      if (Existing->Type == Type && Existing->Name == Name) {
+         return *Existing;
+      }
+   }
+
+   static Entry Overflow [] = {
+      { "stats.overflow", Kind::Counter },
+      { "stats.overflow", Kind::Timing },
+      { "stats.overflow", Kind::Sample }
+   };
+
+   return Overflow [(int) Type];
+}
+
+Napi::Object Stats::summarize (Napi::Env Env, const Histogram::Summary& Summary, double Scale)
+{
+   Napi::Object Result = Napi::Object::New (Env);
+
+   Result.Set ("count", Napi::Number::New (Env, (double) Summary.Count));
+   Result.Set ("mean", Napi::Number::New (Env, Summary.Mean * Scale));
+   Result.Set ("min", Napi::Number::New (Env, Summary.Minimum * Scale));
+   Result.Set ("max", Napi::Number::New (Env, Summary.Maximum * Scale));
+   Result.Set ("p50", Napi::Number::New (Env, Summary.P50 * Scale));
+   Result.Set ("p90", Napi::Number::New (Env, Summary.P90 * Scale));
+   Result.Set ("p99", Napi::Number::New (Env, Summary.P99 * Scale));
+
+   return Result;
+}
+
+void Stats::Histogram::record (uint64_t Value)
+{
+   Buckets [bucket (Value)].fetch_add (1, std::memory_order_relaxed);
+
+   Count.fetch_add (1, std::memory_order_relaxed);
+   Total.fetch_add (Value, std::memory_order_relaxed);
+
+   uint64_t Low = Minimum.load (std::memory_order_relaxed);
+
+   while (Value < Low && !Minimum.compare_exchange_weak (Low, Value, std::memory_order_relaxed)) {
+   }
+
+   uint64_t High = Maximum.load (std::memory_order_relaxed);
+
+   while (Value > High && !Maximum.compare_exchange_weak (High, Value, std::memory_order_relaxed)) {
+   }
+}
+
+void Stats::Histogram::reset ()
+{
+   for (std::atomic<int64_t>& Bucket : Buckets) {
+      Bucket.store (0, std::memory_order_relaxed);
+   }
+
+   Count.store (0, std::memory_order_relaxed);
+   Total.store (0, std::memory_order_relaxed);
+   Minimum.store (UINT64_MAX, std::memory_order_relaxed);
+   Maximum.store (0, std::memory_order_relaxed);
+}
+
+Stats::Histogram::Summary Stats::Histogram::summarize () const
+{
+   // Recording goes on meanwhile, the percentiles come from the buckets
+   // alone so that they agree with each other.
+   std::array<int64_t, BUCKET_COUNT> Counts;
+   int64_t Recorded = 0;
+
+   for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+      Counts [i] = Buckets [i].load (std::memory_order_relaxed);
+      Recorded += Counts [i];
+   }
+
+   Summary Result {};
+
+   Result.Count = Count.load (std::memory_order_relaxed);
+
+   if (Result.Count == 0 || Recorded == 0) {
+      return Result;
+   }
+
+   Result.Mean = (double) Total.load (std::memory_order_relaxed) / Result.Count;
+   Result.Minimum = Minimum.load (std::memory_order_relaxed);
+   Result.Maximum = Maximum.load (std::memory_order_relaxed);
+
+   std::pair<double, uint64_t*> Percentiles [] = {
+      { 0.50, &Result.P50 },
+      { 0.90, &Result.P90 },
+      { 0.99, &Result.P99 }
+   };
+
+   for (auto& [ Fraction, Value ] : Percentiles) {
+      int64_t Rank = std::max ((int64_t) 1, (int64_t) std::ceil (Fraction * Recorded));
+      int64_t Seen = 0;
+
+      for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+         Seen += Counts [i];
+
+         if (Seen >= Rank) {
+            *Value = std::min (highest (i), Result.Maximum);
+            break;
+         }
+      }
+   }
+
+   return Result;
+}
+
+size_t Stats::Histogram::bucket (uint64_t Value)
+{
+   // Below 2 * SUB_BUCKETS every value has a bucket of its own, above it
+   // the top bits pick the bucket within its power of two.
+   int Shift = 0;
+
+   while ((Value >> Shift) >= 2 * SUB_BUCKETS && Shift < MAX_SHIFT) {
+      Shift += 1;
+   }
+
+   return std::min ((size_t) Shift * SUB_BUCKETS + (size_t) (Value >> Shift), BUCKET_COUNT - 1);
+}
+
+uint64_t Stats::Histogram::highest (size_t Bucket)
+{
+   if (Bucket < 2 * SUB_BUCKETS) {
+      return Bucket;
+   }
+
+   int Shift = (int) (Bucket / SUB_BUCKETS) - 1;
+   uint64_t Mantissa = Bucket - (size_t) Shift * SUB_BUCKETS;
+
+   return ((Mantissa + 1) << Shift) - 1;
+}
\ No newline at end of file
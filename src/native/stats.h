@@ -0,0 +1,126 @@
+#pragma once
+
+#include <napi.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Process wide counters and stage timings of the native module, readable from
+// JS through getStats. Recording never takes a lock and only allocates the
+// first time a name is seen, so it stays on in release builds.
+class Stats
+{
+   public:
+
+   // Records the time between its construction and destruction, and traces
+   // it as a stage of the calling thread's scan.
+   class Timer
+   {
+      public:
+
+      // Name must outlive the timer, like a literal.
+      Timer (const char* Name);
+      ~Timer ();
+
+      private:
+
+      const char* Name;
+      std::chrono::steady_clock::time_point Start;
+   };
+
+   static void count (std::string_view Name, int64_t Amount = 1);
+   static void time (std::string_view Name, double Milliseconds);
+
+   // Records a value that is not a duration, like a count per scan. Values
+   // are kept in whole units.
+   static void sample (std::string_view Name, double Value);
+
+   static Napi::Object snapshot (Napi::Env Env);
+
+   // Zeroes every counter and histogram. A value recorded while it runs may
+   // survive it.
+   static void reset ();
+
+   private:
+
+   // Distribution of whole numbers in log-linear buckets, like an HDR
+   // histogram: every power of two is split into SUB_BUCKETS buckets, so a
+   // percentile is off by at most 1 / SUB_BUCKETS of its value.
+   class Histogram
+   {
+      public:
+
+      struct Summary
+      {
+         int64_t Count;
+         double Mean;
+         uint64_t Minimum;
+         uint64_t Maximum;
+         uint64_t P50;
+         uint64_t P90;
+         uint64_t P99;
+      };
+
+      void record (uint64_t Value);
+      void reset ();
+
+      Summary summarize () const;
+
+      private:
+
+      static constexpr int SUB_BUCKETS = 32;
+
+      // Values from SUB_BUCKETS << (MAX_SHIFT + 1) on share the last bucket,
+      // in microseconds that is over a month.
+      static constexpr int MAX_SHIFT = 36;
+
+      static constexpr size_t BUCKET_COUNT = (MAX_SHIFT + 2) * SUB_BUCKETS;
+
+      std::array<std::atomic<int64_t>, BUCKET_COUNT> Buckets {};
+
+      std::atomic<int64_t> Count = 0;
+      std::atomic<uint64_t> Total = 0;
+      std::atomic<uint64_t> Minimum = UINT64_MAX;
+      std::atomic<uint64_t> Maximum = 0;
+
+      static size_t bucket (uint64_t Value);
+
+      // Highest value that falls into the bucket.
+      static uint64_t highest (size_t Bucket);
+   };
+
+   enum class Kind { Counter, Timing, Sample };
+
+   struct Entry
+   {
+      Entry (std::string_view Name, Kind Type);
+
+      const std::string Name;
+      const Kind Type;
+
+      std::atomic<int64_t> Counter = 0;
+
+      // Nothing for counters
+      const std::unique_ptr<Histogram> Values;
+   };
+
+   // Open addressed, a slot is claimed by its hash and keeps its entry for
+   // as long as the process runs.
+   struct Slot
+   {
+      std::atomic<uint64_t> Hash = 0;
+      std::atomic<Entry*> Value = nullptr;
+   };
+
+   // More than the module ever records, names past it are dropped.
+   static constexpr size_t SLOT_COUNT = 512;
+
+   static std::array<Slot, SLOT_COUNT> Slots;
+
+   static Entry& find (std::string_view Name, Kind Type);
+   static Napi::Object summarize (Napi::Env Env, const Histogram::Summary& Summary, double Scale);
+};
\ No newline at end of file
@@ -0,0 +1,308 @@
+// Checks and times WorkPool and ScratchArena on their own, they need nothing
+// but the standard library. From src/native:
+//
+//    g++ -std=c++17 -O2 -pthread -I. pool.cpp test/pool.cpp -o pool-test
+//    cl /std:c++17 /EHsc /O2 /I. pool.cpp test/pool.cpp /Fe:pool-test.exe
+//
+// Add -fsanitize=thread to look for races. Exits with 1 when a check failed.
+
+#include "pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+   int Failures = 0;
+
+   void Check (bool Passed, const std::string& What)
+   {
+      printf ("%s %s\n", Passed ? "ok  " : "FAIL", What.c_str ());
+
+      if (!Passed) {
+         Failures += 1;
+      }
+   }
+
+   // Waits until Done holds, gives up after a few seconds so that a lost
+   // task fails its check instead of hanging.
+   template <typename Condition>
+   bool Await (Condition Done)
+   {
+      auto Deadline = std::chrono::steady_clock::now () + std::chrono::seconds (10);
+
+      while (!Done ()) {
+         if (std::chrono::steady_clock::now () > Deadline) {
+            return false;
+         }
+
+         std::this_thread::sleep_for (std::chrono::milliseconds (1));
+      }
+
+      return true;
+   }
+
+   void NestedParallelFor ()
+   {
+      WorkPool Pool (4);
+
+      // Every pool thread runs a loop of its own, which only finishes when
+      // the thread that started it works through the indices itself.
+      std::atomic<int64_t> Sum = 0;
+      std::atomic<int> Finished = 0;
+
+      for (int Task = 0; Task < Pool.Size (); ++Task) {
+         Pool.Submit ([ & ] () {
+            Pool.ParallelFor (0, 1000, [ & ] (int i) {
+               Sum += i;
+            });
+
+            Finished += 1;
+         });
+      }
+
+      Check (Await ([ & ] () { return Finished.load () == Pool.Size (); }), "parallel loops inside pool tasks finish");
+      Check (Sum.load () == Pool.Size () * 499500LL, "parallel loops inside pool tasks visit every index once");
+
+      // And a loop whose body runs another loop.
+      std::vector<std::atomic<int>> Visits (64 * 64);
+
+      Pool.ParallelFor (0, 64, [ & ] (int Outer) {
+         Pool.ParallelFor (0, 64, [ & ] (int Inner) {
+            Visits [Outer * 64 + Inner] += 1;
+         });
+      });
+
+      bool Once = true;
+
+      for (std::atomic<int>& Each : Visits) {
+         Once = Once && Each.load () == 1;
+      }
+
+      Check (Once, "nested parallel loops visit every index once");
+   }
+
+   void Exceptions ()
+   {
+      WorkPool Pool (4);
+
+      std::atomic<int> Ran = 0;
+      std::string Message;
+
+      try {
+         Pool.ParallelFor (0, 100, [ & ] (int i) {
+            Ran += 1;
+
+            if (i == 37) {
+               throw std::runtime_error ("index 37");
+            }
+         });
+      } catch (const std::runtime_error& Error) {
+         Message = Error.what ();
+      }
+
+      Check (Message == "index 37", "parallel loop rethrows what its body threw");
+      Check (Ran.load () == 100, "parallel loop runs the other indices after a throw");
+
+      // A task that throws is dropped and its thread keeps working.
+      for (int i = 0; i < Pool.Size (); ++i) {
+         Pool.Submit ([] () {
+            throw std::runtime_error ("dropped");
+         });
+      }
+
+      std::atomic<int> After = 0;
+
+      for (int i = 0; i < 32; ++i) {
+         Pool.Submit ([ & ] () {
+            After += 1;
+         });
+      }
+
+      Check (Await ([ & ] () { return After.load () == 32; }), "threads keep running tasks after one threw");
+   }
+
+   void Stealing ()
+   {
+      WorkPool Pool (4);
+
+      // Tasks submitted from a pool thread go to its own queue, while it is
+      // busy the other threads can only get them by stealing.
+      std::atomic<int> Ran = 0;
+      std::atomic<bool> Queued = false;
+
+      Pool.Submit ([ & ] () {
+         for (int i = 0; i < 64; ++i) {
+            Pool.Submit ([ & ] () {
+               std::this_thread::sleep_for (std::chrono::microseconds (200));
+               Ran += 1;
+            });
+         }
+
+         Queued = true;
+
+         Await ([ & ] () { return Ran.load () == 64; });
+      });
+
+      Check (Await ([ & ] () { return Ran.load () == 64; }), "tasks queued on a busy thread run");
+      Check (Await ([ & ] () { return Pool.Snapshot ().Executed == 65; }), "executed counts every task");
+
+      WorkPool::Counters Counters = Pool.Snapshot ();
+
+      Check (Queued.load () && Counters.Stolen >= 64, "idle threads steal from a busy one, stolen " + std::to_string (Counters.Stolen));
+      Check (Counters.Queued == 0, "nothing is left queued");
+   }
+
+   void Arena ()
+   {
+      ScratchArena Scratch;
+
+      uint8_t* First = (uint8_t*) Scratch.Allocate (3, 1);
+      uint8_t* Aligned = (uint8_t*) Scratch.Allocate (64, 64);
+
+      Check ((uintptr_t) Aligned % 64 == 0, "arena aligns allocations");
+      Check (Aligned >= First + 3, "arena allocations do not overlap");
+
+      // Larger than a block, gets one of its own.
+      uint8_t* Large = (uint8_t*) Scratch.Allocate (4 << 20);
+      Large [(4 << 20) - 1] = 1;
+
+      Scratch.Reset ();
+
+      // Only the largest block is kept, the next task starts at its front
+      // and fits without allocating.
+      uint8_t* Reused = (uint8_t*) Scratch.Allocate (4 << 20);
+
+      Check (Reused == Large, "arena reset keeps the largest block");
+
+      Scratch.Reset ();
+
+      Check (Scratch.Allocate (16) == Large, "arena reset starts over at the front");
+
+      WorkPool Pool (2);
+
+      std::atomic<void*> Seen [2] = { nullptr, nullptr };
+      std::atomic<int> Ran = 0;
+
+      for (int i = 0; i < 2; ++i) {
+         Pool.Submit ([ &, i ] () {
+            ScratchArena* Own = WorkPool::Arena ();
+            Seen [i] = Own ? Own->Allocate (128) : nullptr;
+            Ran += 1;
+         });
+      }
+
+      Check (Await ([ & ] () { return Ran.load () == 2; }), "tasks with scratch memory run");
+      Check (Seen [0].load () && Seen [1].load (), "pool threads have an arena");
+      Check (WorkPool::Arena () == nullptr, "other threads have no arena");
+
+      // Run on the same thread one after the other, the second task gets the
+      // memory of the first back.
+      WorkPool Single (1);
+
+      std::atomic<void*> Before = nullptr;
+      std::atomic<void*> Again = nullptr;
+
+      Single.Submit ([ & ] () { Before = WorkPool::Arena ()->Allocate (256); });
+      Single.Submit ([ & ] () { Again = WorkPool::Arena ()->Allocate (256); });
+
+      Check (Await ([ & ] () { return Again.load () != nullptr; }) && Before.load () == Again.load (), "arena is reset after every task");
+   }
+
+   void Destructor ()
+   {
+      std::atomic<int> Ran = 0;
+      std::atomic<int> Started = 0;
+      std::atomic<int> Stopped = 0;
+
+      {
+         WorkPool Pool (2, {
+            [ & ] () { Started += 1; },
+            [ & ] () { Stopped += 1; }
+         });
+
+         for (int i = 0; i < 100; ++i) {
+            Pool.Submit ([ & ] () {
+               std::this_thread::sleep_for (std::chrono::microseconds (100));
+               Ran += 1;
+            });
+         }
+      }
+
+      Check (Ran.load () == 100, "destructor runs every pending task, ran " + std::to_string (Ran.load ()));
+      Check (Started.load () == 2 && Stopped.load () == 2, "start and stop hooks run once per thread");
+   }
+
+   // Loop over a frame sized buffer, serial and on the pool, the same shape
+   // as the per row work of the scan stages.
+   void Benchmark ()
+   {
+      const int ROWS = 2160;
+      const int COLUMNS = 3840;
+      const int RUNS = 20;
+
+      std::vector<uint8_t> Frame (ROWS * COLUMNS);
+      std::iota (Frame.begin (), Frame.end (), 0);
+
+      std::vector<int64_t> Rows (ROWS);
+
+      auto Row = [ & ] (int y) {
+         int64_t Sum = 0;
+
+         for (int x = 0; x < COLUMNS; ++x) {
+            Sum += Frame [y * COLUMNS + x] * (x & 7);
+         }
+
+         Rows [y] = Sum;
+      };
+
+      auto Time = [ & ] (const std::function<void ()>& Work) {
+         std::vector<double> Runs;
+
+         for (int i = 0; i < RUNS; ++i) {
+            auto Start = std::chrono::steady_clock::now ();
+            Work ();
+            Runs.push_back (std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - Start).count ());
+         }
+
+         std::sort (Runs.begin (), Runs.end ());
+
+         return Runs [RUNS / 2];
+      };
+
+      double Serial = Time ([ & ] () {
+         for (int y = 0; y < ROWS; ++y) {
+            Row (y);
+         }
+      });
+
+      int64_t Expected = std::accumulate (Rows.begin (), Rows.end (), (int64_t) 0);
+
+      WorkPool Pool ((int) std::thread::hardware_concurrency ());
+
+      double Parallel = Time ([ & ] () {
+         Pool.ParallelFor (0, ROWS, Row);
+      });
+
+      Check (std::accumulate (Rows.begin (), Rows.end (), (int64_t) 0) == Expected, "parallel loop matches the serial one");
+
+      printf ("bench serial %.3f ms, pool of %d %.3f ms (median of %d)\n", Serial, Pool.Size (), Parallel, RUNS);
+   }
+}
+
+int main ()
+{
+   NestedParallelFor ();
+   Exceptions ();
+   Stealing ();
+   Arena ();
+   Destructor ();
+   Benchmark ();
+
+   printf ("%s\n", Failures == 0 ? "all passed" : (std::to_string (Failures) + " failed").c_str ());
+
+   return Failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+// Checks LetterboxBlob against the cvtColor, pad and blobFromImage chain it
+// replaced. Needs OpenCV's core, imgproc and dnn modules. From src/native:
+//
+//    g++ -std=c++17 -O2 -I. preprocess.cpp test/preprocess.cpp $(pkg-config --cflags --libs opencv4) -o preprocess-test
+//    cl /std:c++17 /EHsc /O2 /I. /I..\..\vcpkg_installed\x64-windows\include\opencv4 preprocess.cpp test/preprocess.cpp
+//       /link /LIBPATH:..\..\vcpkg_installed\x64-windows\lib opencv_core4.lib opencv_imgproc4.lib opencv_dnn4.lib /OUT:preprocess-test.exe
+//
+// Exits with 1 when a check failed.
+
+#include "preprocess.h"
+#include <cstdio>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <string>
+
+namespace
+{
+   // LetterboxBlob computes the same 8-bit pixels as cv::resize, so no
+   // difference at all is allowed.
+   const double TOLERANCE = 0;
+
+   int Failures = 0;
+
+   void Check (bool Passed, const std::string& What)
+   {
+      printf ("%s %s\n", Passed ? "ok  " : "FAIL", What.c_str ());
+
+      if (!Passed) {
+         Failures += 1;
+      }
+   }
+
+   // Noise with flat boxes on it, the boxes give the interpolation long runs
+   // and hard edges, the noise every possible pair of neighbours.
+   cv::Mat Screenshot (int Width, int Height, int Channels)
+   {
+      cv::Mat Image (Height, Width, CV_8UC (Channels));
+      cv::RNG Random (Width * 31 + Height * 7 + Channels);
+
+      Random.fill (Image, cv::RNG::UNIFORM, 0, 256);
+
+      for (int i = 0; i < 20; ++i) {
+         cv::Rect Box (
+            Random.uniform (0, Width - 40),
+            Random.uniform (0, Height - 40),
+            Random.uniform (20, 400),
+            Random.uniform (20, 400)
+         );
+
+         cv::rectangle (Image, Box & cv::Rect (0, 0, Width, Height), cv::Scalar::all (Random.uniform (0, 256)), cv::FILLED);
+      }
+
+      return Image;
+   }
+
+   void Letterbox ()
+   {
+      // Monitors the detector runs on. 1280x720 pads to a 1280 square, which
+      // cv::resize shrinks to 640 with INTER_AREA instead.
+      const cv::Size MONITORS [] = {
+         { 1920, 1080 },
+         { 2560, 1440 },
+         { 3840, 2160 },
+         { 1280, 720 },
+         { 1366, 768 },
+         { 3440, 1440 },
+         { 1080, 1920 },
+         { 1279, 721 }
+      };
+
+      const int SIZES [] = { 640, 416, 320 };
+
+      // Shared by every call, like the detector's own blob.
+      cv::Mat Blob;
+
+      for (const cv::Size& Monitor : MONITORS) {
+         for (int Channels : { 3, 4 }) {
+            cv::Mat Image = Screenshot (Monitor.width, Monitor.height, Channels);
+
+            for (int Size : SIZES) {
+               cv::Mat Reference;
+
+               LetterboxBlob (Image, Blob, Size, Size);
+               LetterboxBlobReference (Image, Reference, Size, Size);
+
+               double Difference = cv::norm (Blob, Reference, cv::NORM_INF);
+
+               Check (
+                  Blob.size == Reference.size && Difference <= TOLERANCE,
+                  "letterbox " + std::to_string (Monitor.width) + "x" + std::to_string (Monitor.height) +
+                  " with " + std::to_string (Channels) + " channels to " + std::to_string (Size) +
+                  ", off by " + std::to_string (Difference * 255) + " levels"
+               );
+            }
+         }
+      }
+   }
+}
+
+int main ()
+{
+   Letterbox ();
+
+   printf ("%s\n", Failures == 0 ? "all passed" : (std::to_string (Failures) + " failed").c_str ());
+
+   return Failures == 0 ? 0 : 1;
+}
\ No newline at end of file
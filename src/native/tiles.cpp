@@ -0,0 +1,161 @@
+#include "tiles.h"
+#include <cstring>
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace {
+
+const uint32_t PRIME_1 = 0x9E3779B1U;
+const uint32_t PRIME_2 = 0x85EBCA77U;
+const uint32_t PRIME_3 = 0xC2B2AE3DU;
+
+inline uint32_t RotateLeft (uint32_t Value, int Bits)
+{
+   return (Value << Bits) | (Value >> (32 - Bits));
+}
+
+inline uint32_t Round (uint32_t Accumulator, uint32_t Input)
+{
+   return RotateLeft (Accumulator + Input * PRIME_2, 13) * PRIME_1;
+}
+
+// xxHash32 style hash of one tile. Every SIMD lane is an independent
+// accumulator fed with consecutive 32-bit words of each row, the lanes are
+// merged at the end. The hash is only compared within one process so it does
+// not matter that the value depends on the vector width.
+uint64_t HashTile (const cv::Mat& Image, const cv::Rect& Tile)
+{
+   size_t Bytes = (size_t) Tile.width * Image.elemSize ();
+
+   uint32_t Tail = PRIME_3;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+   const int Lanes = cv::VTraits<cv::v_uint32>::vlanes ();
+   const size_t Step = cv::VTraits<cv::v_uint8>::vlanes ();
+
+   cv::v_uint32 VPrime1 = cv::vx_setall_u32 (PRIME_1);
+   cv::v_uint32 VPrime2 = cv::vx_setall_u32 (PRIME_2);
+   cv::v_uint32 Accumulator = cv::vx_setall_u32 (PRIME_1 + PRIME_2);
+#else
+   const size_t Step = 16;
+
+   uint32_t Accumulator [4] = { PRIME_1 + PRIME_2, PRIME_2, 0, PRIME_1 };
+#endif
+
+   for (int y = Tile.y; y < Tile.br ().y; ++y) {
+      const uint8_t* Row = Image.ptr<uint8_t> (y) + Tile.x * Image.elemSize ();
+
+      size_t i = 0;
+
+      for (; i + Step <= Bytes; i += Step) {
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+         cv::v_uint32 Input = cv::v_reinterpret_as_u32 (cv::vx_load (Row + i));
+
+         Accumulator = cv::v_add (Accumulator, cv::v_mul (Input, VPrime2));
+         Accumulator = cv::v_or (cv::v_shl<13> (Accumulator), cv::v_shr<19> (Accumulator));
+         Accumulator = cv::v_mul (Accumulator, VPrime1);
+#else
+         for (int Lane = 0; Lane < 4; ++Lane) {
+            uint32_t Input;
+            std::memcpy (&Input, Row + i + Lane * 4, 4);
+            Accumulator [Lane] = Round (Accumulator [Lane], Input);
+         }
+#endif
+      }
+
+      for (; i < Bytes; ++i) {
+         Tail = RotateLeft (Tail + Row [i] * PRIME_3, 11) * PRIME_1;
+      }
+   }
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+   uint32_t Merged [cv::VTraits<cv::v_uint32>::max_nlanes];
+   cv::v_store (Merged, Accumulator);
+#else
+   const int Lanes = 4;
+   uint32_t* Merged = Accumulator;
+#endif
+
+   uint64_t Hash = Tail;
+
+   for (int Lane = 0; Lane < Lanes; ++Lane) {
+      Hash = (Hash << 7 | Hash >> 57) ^ Round ((uint32_t) Hash, Merged [Lane]);
+      Hash *= 0x9E3779B97F4A7C15ULL;
+   }
+
+   return Hash ^ (Hash >> 29);
+}
+
+}
+
+void TileHashes::HashArea (const cv::Mat& Image, const cv::Rect& Area, std::vector<uint64_t>& Hashes)
+{
+   Hashes.clear ();
+
+   for (int y = Area.y; y < Area.br ().y; y += TILE_SIZE) {
+      for (int x = Area.x; x < Area.br ().x; x += TILE_SIZE) {
+         cv::Rect Tile = Area & cv::Rect (x, y, TILE_SIZE, TILE_SIZE);
+         Hashes.push_back (HashTile (Image, Tile));
+      }
+   }
+}
+
+void TileHashes::Compute (const cv::Mat& Image, const cv::Rect& Region)
+{
+   cv::Rect Bounds (0, 0, Image.cols, Image.rows);
+   cv::Rect Clipped = Region & Bounds;
+
+   FrameSize = Image.size ();
+   FrameType = Image.type ();
+
+   if (Clipped.empty ()) {
+      Area = cv::Rect ();
+      Hashes.clear ();
+      return;
+   }
+
+   // Snap outwards to the tile grid.
+   int Left = Clipped.x / TILE_SIZE * TILE_SIZE;
+   int Top = Clipped.y / TILE_SIZE * TILE_SIZE;
+   int Right = (Clipped.br ().x + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+   int Bottom = (Clipped.br ().y + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+
+   Area = Bounds & cv::Rect (Left, Top, Right - Left, Bottom - Top);
+
+   HashArea (Image, Area, Hashes);
+}
+
+bool TileHashes::Matches (const cv::Mat& Image) const
+{
+   if (Hashes.empty () || Image.size () != FrameSize || Image.type () != FrameType) {
+      return false;
+   }
+
+   // Compare tile by tile so the first changed tile ends the check.
+   int Index = 0;
+
+   for (int y = Area.y; y < Area.br ().y; y += TILE_SIZE) {
+      for (int x = Area.x; x < Area.br ().x; x += TILE_SIZE) {
+         cv::Rect Tile = Area & cv::Rect (x, y, TILE_SIZE, TILE_SIZE);
+
+         if (HashTile (Image, Tile) != Hashes [Index++]) {
+            return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+void TileHashes::Clear ()
+{
+   FrameSize = cv::Size ();
+   FrameType = -1;
+   Area = cv::Rect ();
+   Hashes.clear ();
+}
+
+bool TileHashes::Empty () const
+{
+   return Hashes.empty ();
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+#include <vector>
+
+// Hashes of the fixed size tiles covering part of a frame, used to tell
+// cheaply whether anything in that part of the screen changed.
+class TileHashes
+{
+   public:
+
+   static constexpr int TILE_SIZE = 64;
+
+   // Hashes every tile that overlaps Region.
+   void Compute (const cv::Mat& Image, const cv::Rect& Region);
+
+   // True when Image has the same size and type and identical tiles to the ones
+   // hashed by the last Compute.
+   bool Matches (const cv::Mat& Image) const;
+
+   void Clear ();
+   bool Empty () const;
+
+   private:
+
+   cv::Size FrameSize;
+   int FrameType = -1;
+
+   // Tile aligned area that was hashed, clipped to the frame.
+   cv::Rect Area;
+
+   std::vector<uint64_t> Hashes;
+
+   static void HashArea (const cv::Mat& Image, const cv::Rect& Area, std::vector<uint64_t>& Hashes);
+};
\ No newline at end of file
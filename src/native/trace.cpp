@@ -0,0 +1,265 @@
+#include "trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <windows.h>
+
+namespace
+{
+   thread_local uint64_t CurrentScan = 0;
+}
+
+std::mutex Trace::Lock;
+
+std::atomic<Trace::Ring*> Trace::Current = nullptr;
+std::vector<std::unique_ptr<Trace::Ring>> Trace::Rings;
+
+Trace::Scope::Scope (uint64_t Scan) : Previous (CurrentScan)
+{
+   CurrentScan = Scan;
+}
+
+Trace::Scope::~Scope ()
+{
+   CurrentScan = Previous;
+}
+
+Trace::Ring::Ring (size_t Capacity) : Capacity (Capacity),
+   Slots (std::make_unique<Slot []> (Capacity))
+{
+}
+
+void Trace::configure (size_t Capacity)
+{
+   std::lock_guard<std::mutex> Guard (Lock);
+
+   if (Capacity == 0) {
+      Current.store (nullptr, std::memory_order_release);
+      return;
+   }
+
+   auto Found = std::find_if (Rings.begin (), Rings.end (), [ & ] (const std::unique_ptr<Ring>& Each) {
+      return Each->Capacity == Capacity;
+   });
+
+   if (Found == Rings.end ()) {
+      Rings.push_back (std::make_unique<Ring> (Capacity));
+      Found = Rings.end () - 1;
+   }
+
+   Ring* Buffer = Found->get ();
+   Buffer->First.store (Buffer->Next.load ());
+
+   Current.store (Buffer, std::memory_order_release);
+}
+
+bool Trace::enabled ()
+{
+   return Current.load (std::memory_order_relaxed) != nullptr;
+}
+
+int64_t Trace::now ()
+{
+   return at (std::chrono::steady_clock::now ());
+}
+
+int64_t Trace::at (std::chrono::steady_clock::time_point Time)
+{
+   return std::chrono::duration_cast<std::chrono::microseconds> (Time.time_since_epoch ()).count ();
+}
+
+uint64_t Trace::current ()
+{
+   return CurrentScan;
+}
+
+void Trace::complete (std::string_view Name, std::chrono::steady_clock::time_point Start, std::chrono::steady_clock::time_point End)
+{
+   if (!enabled ()) {
+      return;
+   }
+
+   int64_t Begin = at (Start);
+
+   record ({
+      Name,
+      "native",
+      Begin,
+      at (End) - Begin,
+      CurrentScan,
+      (int64_t) GetCurrentProcessId (),
+      (int64_t) GetCurrentThreadId ()
+   });
+}
+
+void Trace::record (const Event& Entry)
+{
+   Ring* Buffer = Current.load (std::memory_order_acquire);
+
+   if (!Buffer) {
+      return;
+   }
+
+   uint64_t Number = Buffer->Next.fetch_add (1, std::memory_order_relaxed);
+   Slot& Target = Buffer->Slots [Number % Buffer->Capacity];
+
+   uint64_t Writing = 2 * Number + 1;
+   uint64_t Seen = Target.Sequence.load (std::memory_order_relaxed);
+
+   // Only loops when the ring went all the way around while an older event
+   // was still being written into the slot, or a newer one already took it.
+   while (true) {
+      if (Seen > Writing) {
+         return;
+      }
+
+      if (Seen % 2 == 1) {
+         std::this_thread::yield ();
+         Seen = Target.Sequence.load (std::memory_order_relaxed);
+         continue;
+      }
+
+      if (Target.Sequence.compare_exchange_weak (Seen, Writing, std::memory_order_relaxed)) {
+         break;
+      }
+   }
+
+   // Every field is stored with release, so a dump that reads a new field
+   // also sees the slot marked as being written.
+   store (Target.Name, NAME_WORDS, Entry.Name);
+   store (Target.Category, CATEGORY_WORDS, Entry.Category);
+
+   Target.Start.store (Entry.Start, std::memory_order_release);
+   Target.Duration.store (Entry.Duration, std::memory_order_release);
+   Target.Scan.store (Entry.Scan, std::memory_order_release);
+   Target.Process.store (Entry.Process, std::memory_order_release);
+   Target.Thread.store (Entry.Thread, std::memory_order_release);
+
+   Target.Sequence.store (Writing + 1, std::memory_order_release);
+}
+
+std::string Trace::dump ()
+{
+   std::lock_guard<std::mutex> Guard (Lock);
+
+   std::string Json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+   Ring* Buffer = Current.load (std::memory_order_acquire);
+
+   if (!Buffer) {
+      return Json + "]}";
+   }
+
+   // Recording goes on meanwhile, an event whose slot is overwritten before
+   // it was read is left out.
+   uint64_t End = Buffer->Next.load (std::memory_order_acquire);
+   uint64_t Begin = std::max (Buffer->First.load (), End > Buffer->Capacity ? End - Buffer->Capacity : 0);
+
+   bool First = true;
+
+   for (uint64_t Number = Begin; Number < End; ++Number) {
+      const Slot& Each = Buffer->Slots [Number % Buffer->Capacity];
+
+      uint64_t Written = 2 * Number + 2;
+
+      if (Each.Sequence.load (std::memory_order_acquire) != Written) {
+         continue;
+      }
+
+      std::string Name = load (Each.Name, NAME_WORDS);
+      std::string Category = load (Each.Category, CATEGORY_WORDS);
+
+      int64_t Start = Each.Start.load (std::memory_order_acquire);
+      int64_t Duration = Each.Duration.load (std::memory_order_acquire);
+      uint64_t Scan = Each.Scan.load (std::memory_order_acquire);
+      int64_t Process = Each.Process.load (std::memory_order_acquire);
+      int64_t Thread = Each.Thread.load (std::memory_order_acquire);
+
+      // A writer took the slot while it was read.
+      if (Each.Sequence.load (std::memory_order_relaxed) != Written) {
+         continue;
+      }
+
+      char Numbers [160];
+
+      snprintf (
+         Numbers,
+         sizeof (Numbers),
+         "\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%lld,\"tid\":%lld,\"args\":{\"scan\":%llu}",
+         (long long) Start,
+         (long long) Duration,
+         (long long) Process,
+         (long long) Thread,
+         (unsigned long long) Scan
+      );
+
+      if (!First) {
+         Json += ",";
+      }
+
+      First = false;
+
+      Json += "{\"name\":\"" + escape (Name) + "\",\"cat\":\"" + escape (Category) + "\"," + Numbers + "}";
+   }
+
+   Json += "]}";
+
+   return Json;
+}
+
+void Trace::store (std::atomic<uint64_t>* Words, size_t Count, std::string_view Text)
+{
+   char Bytes [NAME_WORDS * sizeof (uint64_t)] = {};
+
+   // The last byte stays zero, and a cut never splits a UTF-8 sequence.
+   size_t Length = std::min (Text.size (), Count * sizeof (uint64_t) - 1);
+
+   if (Length < Text.size ()) {
+      while (Length > 0 && ((unsigned char) Text [Length] & 0xC0) == 0x80) {
+         Length -= 1;
+      }
+   }
+
+   memcpy (Bytes, Text.data (), Length);
+
+   for (size_t i = 0; i < Count; ++i) {
+      uint64_t Word;
+      memcpy (&Word, Bytes + i * sizeof (uint64_t), sizeof (uint64_t));
+
+      Words [i].store (Word, std::memory_order_release);
+   }
+}
+
+std::string Trace::load (const std::atomic<uint64_t>* Words, size_t Count)
+{
+   char Bytes [NAME_WORDS * sizeof (uint64_t)];
+
+   for (size_t i = 0; i < Count; ++i) {
+      uint64_t Word = Words [i].load (std::memory_order_acquire);
+      memcpy (Bytes + i * sizeof (uint64_t), &Word, sizeof (uint64_t));
+   }
+
+   return std::string (Bytes, strnlen (Bytes, Count * sizeof (uint64_t)));
+}
+
+std::string Trace::escape (std::string_view Text)
+{
+   std::string Escaped;
+
+   for (char Character : Text) {
+      if (Character == '"' || Character == '\\') {
+         Escaped += '\\';
+         Escaped += Character;
+      } else if ((unsigned char) Character < 0x20) {
+         char Code [8];
+         snprintf (Code, sizeof (Code), "\\u%04x", Character);
+
+         Escaped += Code;
+      } else {
+         Escaped += Character;
+      }
+   }
+
+   return Escaped;
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Trace events of the scans in the Chrome Trace Event format, kept in a ring
+// buffer until dumpTrace exports them as JSON for chrome://tracing or
+// Perfetto. Every event carries the correlation ID of the scan it belongs to,
+// which JS passes to getTooltip, so the native stages line up with the IPC
+// and HTTP steps JS records around them.
+//
+// Recording never takes a lock or allocates: an event claims the next slot
+// of a preallocated ring and copies its names into it, cut to fit.
+class Trace
+{
+   public:
+
+   // The names are copied when the event is recorded.
+   struct Event
+   {
+      std::string_view Name;
+      std::string_view Category;
+
+      // Microseconds on the trace clock
+      int64_t Start;
+      int64_t Duration;
+
+      // Zero when the event belongs to no scan
+      uint64_t Scan;
+
+      int64_t Process;
+      int64_t Thread;
+   };
+
+   // Makes Scan the correlation ID of the events the calling thread records
+   // until it is destroyed.
+   class Scope
+   {
+      public:
+
+      Scope (uint64_t Scan);
+      ~Scope ();
+
+      private:
+
+      uint64_t Previous;
+   };
+
+   // Keeps the last Capacity events, none at all with zero. Drops the events
+   // recorded so far.
+   static void configure (size_t Capacity);
+
+   static bool enabled ();
+
+   // Microseconds on the steady clock the native stages are timed with
+   static int64_t now ();
+   static int64_t at (std::chrono::steady_clock::time_point Time);
+
+   // Correlation ID of the calling thread's scan
+   static uint64_t current ();
+
+   // Records a native stage of the calling thread's scan.
+   static void complete (std::string_view Name, std::chrono::steady_clock::time_point Start, std::chrono::steady_clock::time_point End);
+
+   static void record (const Event& Entry);
+
+   // The buffered events, oldest first, as a trace JSON document.
+   static std::string dump ();
+
+   private:
+
+   // Longer names are cut, stage names are far shorter.
+   static constexpr size_t NAME_WORDS = 6;
+   static constexpr size_t CATEGORY_WORDS = 2;
+
+   // Written by one thread at a time, dump reads it meanwhile and skips it
+   // when it changed under it. Every field is atomic for that, the words hold
+   // the names zero padded.
+   struct Slot
+   {
+      // 2 * N + 1 while event N is written into the slot, 2 * N + 2 once
+      // it is. Zero when the slot never held an event.
+      std::atomic<uint64_t> Sequence = 0;
+
+      std::atomic<uint64_t> Name [NAME_WORDS] {};
+      std::atomic<uint64_t> Category [CATEGORY_WORDS] {};
+
+      std::atomic<int64_t> Start = 0;
+      std::atomic<int64_t> Duration = 0;
+      std::atomic<uint64_t> Scan = 0;
+      std::atomic<int64_t> Process = 0;
+      std::atomic<int64_t> Thread = 0;
+   };
+
+   struct Ring
+   {
+      Ring (size_t Capacity);
+
+      const size_t Capacity;
+      const std::unique_ptr<Slot []> Slots;
+
+      // Event number of the next event, it goes to Next % Capacity.
+      std::atomic<uint64_t> Next = 0;
+
+      // Events before it were recorded before the last configure.
+      std::atomic<uint64_t> First = 0;
+   };
+
+   // Held by configure and dump only.
+   static std::mutex Lock;
+
+   // Nothing when tracing is off.
+   static std::atomic<Ring*> Current;
+
+   // Every ring configure made, a thread may still be recording into one
+   // that was replaced. A capacity used before gets its ring back.
+   static std::vector<std::unique_ptr<Ring>> Rings;
+
+   static void store (std::atomic<uint64_t>* Words, size_t Count, std::string_view Text);
+   static std::string load (const std::atomic<uint64_t>* Words, size_t Count);
+
+   static std::string escape (std::string_view Text);
+};
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "tracker.h"
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+// Patches with less contrast than this correlate with noise about as well as
+// with themselves.
+const double MINIMUM_PATCH_DEVIATION = 8.0;
+
+}
+
+bool TooltipTracker::Extract (const cv::Mat& Image, const cv::Rect& Area, cv::Mat& Gray)
+{
+   cv::Rect Bounds (0, 0, Image.cols, Image.rows);
+
+   if ((Area & Bounds) != Area || Area.empty ()) {
+      return false;
+   }
+
+   switch (Image.channels ()) {
+      case 4:
+         cv::cvtColor (Image (Area), Gray, cv::COLOR_BGRA2GRAY);
+         break;
+      case 3:
+         cv::cvtColor (Image (Area), Gray, cv::COLOR_BGR2GRAY);
+         break;
+      default:
+         Image (Area).copyTo (Gray);
+         break;
+   }
+
+   return true;
+}
+
+std::optional<cv::Point> TooltipTracker::Find (const cv::Mat& Image, const cv::Mat& Patch, cv::Point Origin)
+{
+   cv::Rect Window (
+      Origin.x - SEARCH_RADIUS,
+      Origin.y - SEARCH_RADIUS,
+      PATCH_SIZE + 2 * SEARCH_RADIUS,
+      PATCH_SIZE + 2 * SEARCH_RADIUS
+   );
+
+   // Near the frame edge the window is clipped, it only has to fit the patch.
+   Window &= cv::Rect (0, 0, Image.cols, Image.rows);
+
+   if (Window.width < PATCH_SIZE || Window.height < PATCH_SIZE) {
+      return std::nullopt;
+   }
+
+   cv::Mat Gray;
+   Extract (Image, Window, Gray);
+
+   cv::Mat Scores;
+   cv::matchTemplate (Gray, Patch, Scores, cv::TM_CCOEFF_NORMED);
+
+   double Best;
+   cv::Point Location;
+   cv::minMaxLoc (Scores, nullptr, &Best, nullptr, &Location);
+
+   if (Best < MINIMUM_CORRELATION) {
+      return std::nullopt;
+   }
+
+   return Window.tl () + Location;
+}
+
+bool TooltipTracker::Reset (const cv::Mat& Image, const cv::Rect& Area)
+{
+   Clear ();
+
+   if (Area.width < 2 * PATCH_SIZE || Area.height < 2 * PATCH_SIZE) {
+      return false;
+   }
+
+   cv::Rect TopLeftArea (Area.tl (), cv::Size (PATCH_SIZE, PATCH_SIZE));
+   cv::Rect BottomRightArea (Area.br () - cv::Point (PATCH_SIZE, PATCH_SIZE), cv::Size (PATCH_SIZE, PATCH_SIZE));
+
+   if (!Extract (Image, TopLeftArea, TopLeft) || !Extract (Image, BottomRightArea, BottomRight)) {
+      Clear ();
+      return false;
+   }
+
+   for (const cv::Mat* Patch : { &TopLeft, &BottomRight }) {
+      cv::Scalar Mean, Deviation;
+      cv::meanStdDev (*Patch, Mean, Deviation);
+
+      if (Deviation [0] < MINIMUM_PATCH_DEVIATION) {
+         Clear ();
+         return false;
+      }
+   }
+
+   Tooltip = Area;
+   FrameType = Image.type ();
+
+   return true;
+}
+
+std::optional<cv::Rect> TooltipTracker::Track (const cv::Mat& Image) const
+{
+   if (Empty () || Image.type () != FrameType) {
+      return std::nullopt;
+   }
+
+   std::optional<cv::Point> First = Find (Image, TopLeft, Tooltip.tl ());
+
+   if (!First) {
+      return std::nullopt;
+   }
+
+   std::optional<cv::Point> Second = Find (Image, BottomRight, Tooltip.br () - cv::Point (PATCH_SIZE, PATCH_SIZE));
+
+   if (!Second) {
+      return std::nullopt;
+   }
+
+   cv::Point Shift = *First - Tooltip.tl ();
+
+   // A different shift means the tooltip changed size, most likely because
+   // another item is hovered.
+   if (*Second - (Tooltip.br () - cv::Point (PATCH_SIZE, PATCH_SIZE)) != Shift) {
+      return std::nullopt;
+   }
+
+   return Tooltip + Shift;
+}
+
+void TooltipTracker::Clear ()
+{
+   Tooltip = cv::Rect ();
+   FrameType = -1;
+   TopLeft.release ();
+   BottomRight.release ();
+}
+
+bool TooltipTracker::Empty () const
+{
+   return TopLeft.empty ();
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+#include <optional>
+
+// Follows a confirmed tooltip between frames by correlating small patches of
+// its top left and bottom right corners within a window around their last
+// position. Both corners have to be found with the same shift, a tooltip that
+// moved or was resized in any other way is left to the detector.
+class TooltipTracker
+{
+   public:
+
+   // Side of the square corner patches, taken from inside the tooltip.
+   static constexpr int PATCH_SIZE = 24;
+
+   // How far a corner may move between two scans and still be found.
+   static constexpr int SEARCH_RADIUS = 16;
+
+   // Normalized cross correlation both corners need to reach.
+   static constexpr double MINIMUM_CORRELATION = 0.92;
+
+   // Returns false when the corners are too flat to be tracked reliably, the
+   // tracker is empty afterwards.
+   bool Reset (const cv::Mat& Image, const cv::Rect& Area);
+
+   // Returns where the tooltip is in Image or nullopt when either corner was
+   // not found with enough confidence.
+   std::optional<cv::Rect> Track (const cv::Mat& Image) const;
+
+   void Clear ();
+   bool Empty () const;
+
+   private:
+
+   cv::Rect Tooltip;
+   int FrameType = -1;
+
+   cv::Mat TopLeft;
+   cv::Mat BottomRight;
+
+   static bool Extract (const cv::Mat& Image, const cv::Rect& Area, cv::Mat& Gray);
+   static std::optional<cv::Point> Find (const cv::Mat& Image, const cv::Mat& Patch, cv::Point Origin);
+};
\ No newline at end of file
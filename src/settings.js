@@ -43,8 +43,22 @@ settings.general.alignment = toEnum (settings.general.alignment, [ 'attached', '
 settings.general.components = toList (settings.general.components, [ 'header', 'primary', 'secondary', 'details', 'quests', 'pricing' ]);
 settings.general.scale = parseFloat (settings.general.scale || '1.0');
 
+settings.performance.inference_engine = toEnum (settings.performance.inference_engine, [ 'auto', 'opencv', 'onnxruntime', 'openvino' ]);
+settings.performance.quantized_model = toBool (settings.performance.quantized_model);
+settings.performance.border_detector = toBool (settings.performance.border_detector);
+settings.performance.line_segmentation = toBool (settings.performance.line_segmentation);
+settings.performance.glyph_ocr = toBool (settings.performance.glyph_ocr);
+settings.performance.ocr_cache_size = Math.max (0, parseFloat (settings.performance.ocr_cache_size) || 0);
+settings.performance.ocr_x_height = Math.max (0, parseInt (settings.performance.ocr_x_height) || 0);
+settings.performance.two_phase_ocr = toBool (settings.performance.two_phase_ocr);
+settings.performance.continuous_scan = toBool (settings.performance.continuous_scan);
+settings.performance.scan_interval = Math.max (1, parseInt (settings.performance.scan_interval) || 50);
+settings.performance.trace_events = Math.max (0, parseInt (settings.performance.trace_events) || 0);
+settings.performance.detector_input_size = parseInt (toEnum (settings.performance.detector_input_size, [ '640', '512', '416', '320' ]));
+
 settings.hotkeys.toggle_mode = toHotkey (settings.hotkeys.toggle_mode) || 'Ctrl+F6';
 settings.hotkeys.run_price_check = toHotkey (settings.hotkeys.run_price_check) || 'F5';
+settings.hotkeys.save_trace = toHotkey (settings.hotkeys.save_trace) || 'F9';
 
 function toBool (s) {
   if (s === true || s === 'true') return true;
@@ -0,0 +1,51 @@
+import { writeFile } from 'node:fs/promises';
+import { join } from 'node:path';
+import { logger, logPath } from './logger.js';
+import { dumpTrace, recordTrace, traceClock } from './native.js';
+
+// Both JS processes time their steps in epoch milliseconds, which line up
+// across processes. The native module traces on its own clock in
+// microseconds, this is how far apart the two are.
+const offset = traceClock () - now () * 1000;
+
+export function now () {
+  return performance.timeOrigin + performance.now ();
+}
+
+// Records a step of a scan from start to end in epoch milliseconds. Steps of
+// the main process default to its own pid on a thread of their own.
+export function span (name, scan, start, end, { category = 'main', pid = process.pid, tid = 0 } = {}) {
+  recordTrace ({
+    name,
+    category,
+    scan: scan || 0,
+    start: Math.round (start * 1000 + offset),
+    duration: Math.round ((end - start) * 1000),
+    pid,
+    tid
+  });
+}
+
+// Runs work and records it as a step of the scan, also when it throws.
+export async function traced (name, scan, work, options) {
+  let start = now ();
+
+  try {
+    return await work ();
+  } finally {
+    span (name, scan, start, now (), options);
+  }
+}
+
+// Writes the buffered events to the logs folder, they open in
+// chrome://tracing or ui.perfetto.dev.
+export async function saveTrace () {
+  let file = join (logPath, `trace-${new Date ().toISOString ().replace (/[:.]/g, '-')}.json`);
+
+  try {
+    await writeFile (file, dumpTrace ());
+    logger.info (`Saved trace to ${file}`);
+  } catch (e) {
+    logger.error (`Failed to save trace: ${e}`);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+"""Tooltip detector helpers shared by the model tools.
+
+Preprocessing and post-processing mirror Screen::FindTooltips in the native
+module so the tools see the same inputs and boxes as GrimVault does.
+"""
+
+import time
+from pathlib import Path
+
+import cv2
+import numpy as np
+import onnxruntime as ort
+
+MINIMUM_OBJECT_CONFIDENCE = 0.90
+NMS_SCORE_THRESHOLD = 0.45
+NMS_THRESHOLD = 0.50
+
+SCREENSHOT_EXTENSIONS = {'.png', '.jpg', '.jpeg', '.bmp'}
+
+
+def screenshots(directory):
+    """Returns the recorded screenshots in a directory, sorted by name."""
+    return sorted(
+        path for path in Path(directory).iterdir()
+        if path.suffix.lower() in SCREENSHOT_EXTENSIONS
+    )
+
+
+def load_screenshot(path):
+    image = cv2.imread(str(path), cv2.IMREAD_COLOR)
+
+    if image is None:
+        raise ValueError(f'Could not read screenshot: {path}')
+
+    return image
+
+
+def letterbox(image, width, height):
+    """Pads a BGR screenshot to a black square and builds the NCHW RGB blob."""
+    size = max(image.shape[0], image.shape[1])
+
+    padded = np.zeros((size, size, 3), dtype=np.uint8)
+    padded[:image.shape[0], :image.shape[1]] = image
+
+    blob = cv2.dnn.blobFromImage(padded, 1 / 255.0, (width, height), swapRB=True, crop=False)
+
+    return blob, size
+
+
+def decode(output, size, width, height):
+    """Decodes a [1 x (4 + C) x N] output into (boxes, scores) after NMS."""
+    output = output[0]
+
+    scores = output[4:].max(axis=0)
+    keep = scores > MINIMUM_OBJECT_CONFIDENCE
+
+    x, y, w, h = output[:4, keep]
+    x_scale = size / width
+    y_scale = size / height
+
+    boxes = np.stack([
+        (x - 0.5 * w) * x_scale,
+        (y - 0.5 * h) * y_scale,
+        w * x_scale,
+        h * y_scale
+    ], axis=1).astype(int)
+
+    scores = scores[keep]
+
+    indices = cv2.dnn.NMSBoxes(boxes.tolist(), scores.tolist(), NMS_SCORE_THRESHOLD, NMS_THRESHOLD)
+    indices = np.array(indices, dtype=int).reshape(-1)
+
+    return boxes[indices], scores[indices]
+
+
+class Detector:
+    """Runs one ONNX export of the tooltip detector on the CPU."""
+
+    def __init__(self, model, threads=0, size=None):
+        options = ort.SessionOptions()
+        options.graph_optimization_level = ort.GraphOptimizationLevel.ORT_ENABLE_ALL
+
+        if threads:
+            options.intra_op_num_threads = threads
+
+        self.session = ort.InferenceSession(str(model), options, providers=['CPUExecutionProvider'])
+        self.input = self.session.get_inputs()[0]
+
+        # Exports with dynamic axes run at any size, fixed exports only at theirs.
+        shape = self.input.shape
+        self.height = shape[2] if isinstance(shape[2], int) else size or 640
+        self.width = shape[3] if isinstance(shape[3], int) else size or 640
+
+        if size and (self.width, self.height) != (size, size):
+            raise ValueError(f'{model} has a fixed input size of {self.width}x{self.height}')
+
+    def detect(self, image):
+        """Returns (boxes, scores, milliseconds spent in inference)."""
+        blob, size = letterbox(image, self.width, self.height)
+
+        start = time.perf_counter()
+        output = self.session.run(None, {self.input.name: blob})[0]
+        elapsed = (time.perf_counter() - start) * 1000
+
+        boxes, scores = decode(output, size, self.width, self.height)
+
+        return boxes, scores, elapsed
+
+
+def iou(a, b):
+    ax, ay, aw, ah = a
+    bx, by, bw, bh = b
+
+    iw = max(0, min(ax + aw, bx + bw) - max(ax, bx))
+    ih = max(0, min(ay + ah, by + bh) - max(ay, by))
+
+    intersection = iw * ih
+    union = aw * ah + bw * bh - intersection
+
+    return intersection / union if union > 0 else 0.0
+
+
+def percentile(values, p):
+    return float(np.percentile(values, p)) if values else float('nan')
@@ -0,0 +1,97 @@
+"""Compares exports of the tooltip detector against the FP32 reference model.
+
+Every model runs on the same recorded screenshots. The detections of the
+reference model are treated as ground truth, each candidate reports the share
+of them it finds again (recall, IoU >= 0.5), the mean IoU of those matches,
+the boxes it adds that the reference does not have, the share of its own boxes
+that match (precision), and its inference latency.
+
+    python tools/evaluate.py --reference best.onnx --model best.int8.onnx --screenshots recordings/
+"""
+
+import argparse
+from pathlib import Path
+
+from detector import Detector, iou, load_screenshot, percentile, screenshots
+
+MATCH_IOU = 0.5
+
+
+def evaluate(detector, images, reference, warmup):
+    for image in images[:warmup]:
+        detector.detect(image)
+
+    latencies = []
+    matched = 0
+    expected = 0
+    extra = 0
+    overlaps = []
+
+    for image, truth in zip(images, reference):
+        boxes, _, elapsed = detector.detect(image)
+        latencies.append(elapsed)
+
+        unused = list(boxes)
+        expected += len(truth)
+
+        for box in truth:
+            best = max(unused, key=lambda candidate: iou(box, candidate), default=None)
+
+            if best is not None and iou(box, best) >= MATCH_IOU:
+                overlaps.append(iou(box, best))
+                unused = [candidate for candidate in unused if candidate is not best]
+                matched += 1
+
+        extra += len(unused)
+
+    return {
+        'recall': matched / expected if expected else float('nan'),
+        'precision': matched / (matched + extra) if matched + extra else float('nan'),
+        'iou': sum(overlaps) / len(overlaps) if overlaps else float('nan'),
+        'extra': extra,
+        'p50': percentile(latencies, 50),
+        'p99': percentile(latencies, 99),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--reference', required=True, type=Path, help='FP32 ONNX export used as ground truth')
+    parser.add_argument('--model', required=True, type=Path, nargs='+', help='exports to compare')
+    parser.add_argument('--screenshots', required=True, type=Path, help='directory of recorded screenshots')
+    parser.add_argument('--threads', type=int, default=0, help='intra-op threads, 0 lets ONNX Runtime decide')
+    parser.add_argument('--warmup', type=int, default=3)
+    args = parser.parse_args()
+
+    paths = screenshots(args.screenshots)
+
+    if not paths:
+        parser.error(f'No screenshots found in {args.screenshots}')
+
+    images = [load_screenshot(path) for path in paths]
+
+    reference = Detector(args.reference, args.threads)
+    truth = [reference.detect(image)[0] for image in images]
+
+    results = [(args.reference.name, evaluate(reference, images, truth, args.warmup))]
+
+    for model in args.model:
+        results.append((model.name, evaluate(Detector(model, args.threads), images, truth, args.warmup)))
+
+    baseline = results[0][1]['p50']
+
+    print(f'{len(images)} screenshots, {sum(len(boxes) for boxes in truth)} reference tooltips\n')
+    print(
+        f'{"model":<40} {"recall":>7} {"prec":>6} {"iou":>6} {"extra":>6} '
+        f'{"p50 ms":>8} {"p99 ms":>8} {"speedup":>8}'
+    )
+
+    for name, result in results:
+        print(
+            f'{name:<40} {result["recall"]:>7.3f} {result["precision"]:>6.3f} {result["iou"]:>6.3f} {result["extra"]:>6} '
+            f'{result["p50"]:>8.1f} {result["p99"]:>8.1f} {baseline / result["p50"]:>7.2f}x'
+        )
+
+
+if __name__ == '__main__':
+    main()
\ No newline at end of file
@@ -0,0 +1,320 @@
+"""Compares reading tooltips as one block with reading them line by line,
+each at the native size and resampled to a fixed x-height.
+
+Preprocessing, line segmentation and x-height measurement mirror Screen::Read,
+SegmentLines and FitXHeight in the native module. Every tooltip crop is read
+in each mode on the same pool of Tesseract instances. The table shows the
+character error rate and wall clock latency of each.
+
+    python tools/ocr.py --tessdata models/tesseract --tooltips recordings/1080p/ recordings/1440p/ recordings/4k/
+
+Every directory is a recording at one monitor resolution and gets its own
+table. With --simulate a single 1080p recording is also enlarged to 1440p and
+4K, which approximates how the game scales its interface.
+
+The expected text of a crop is read from a .txt file with the same name. When
+there is none, the native single block result is used instead, so the error
+rate becomes the difference to it.
+"""
+
+import argparse
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+
+import cv2
+import numpy as np
+from tesserocr import OEM, PSM, PyTessBaseAPI
+
+from detector import load_screenshot, percentile, screenshots
+
+BORDER_SIZE = 5
+
+INK_LEVEL = 128
+FRAME_COLUMN_RATIO = 0.9
+MINIMUM_ROW_INK = 2
+MAXIMUM_LINE_GAP = 1
+MINIMUM_LINE_HEIGHT = 6
+SEPARATOR_INK_RATIO = 0.6
+LINE_PADDING = 3
+
+X_HEIGHT_INK_RATIO = 0.4
+DPI_PER_X_HEIGHT_PIXEL = 72 / 5
+DEFAULT_DPI = 70
+MINIMUM_DPI = 70
+MAXIMUM_DPI = 2400
+SCALE_TOLERANCE = 0.1
+MINIMUM_SCALE = 0.25
+MAXIMUM_SCALE = 4.0
+
+SIMULATED = [('1440p', 1440 / 1080), ('4k', 2160 / 1080)]
+
+
+def preprocess(image):
+    """Returns the binarized crop Tesseract reads, dark text on white."""
+    processed = cv2.convertScaleAbs(image, alpha=2, beta=0)
+    processed = processed[BORDER_SIZE:-BORDER_SIZE, BORDER_SIZE:-BORDER_SIZE]
+
+    gray = cv2.cvtColor(processed, cv2.COLOR_BGR2GRAY)
+    _, binary = cv2.threshold(gray, 0, 255, cv2.THRESH_BINARY_INV | cv2.THRESH_OTSU)
+
+    return binary
+
+
+def text_ink(binary):
+    """Returns the ink mask without the frame edges left after trimming."""
+    ink = binary < INK_LEVEL
+
+    frame = ink.sum(axis=0) >= FRAME_COLUMN_RATIO * ink.shape[0]
+    ink[:, frame] = False
+
+    return ink
+
+
+def segment_lines(binary):
+    """Returns (start, end) row ranges of the text lines, top to bottom."""
+    ink = text_ink(binary)
+
+    rows = ink.sum(axis=1)
+    lines = []
+
+    def close(start, end):
+        if end - start < MINIMUM_LINE_HEIGHT:
+            return
+
+        if rows[start:end].sum() >= SEPARATOR_INK_RATIO * (end - start) * ink.shape[1]:
+            return
+
+        lines.append((max(start - LINE_PADDING, 0), min(end + LINE_PADDING, ink.shape[0])))
+
+    start = -1
+    last = -1
+
+    for y, count in enumerate(rows):
+        if count >= MINIMUM_ROW_INK:
+            if start < 0:
+                start = y
+
+            last = y
+        elif start >= 0 and y - last > MAXIMUM_LINE_GAP:
+            close(start, last + 1)
+            start = -1
+
+    if start >= 0:
+        close(start, last + 1)
+
+    return lines
+
+
+def measure_x_height(binary):
+    """Returns the median height of the dense ink band of the lines, or 0."""
+    ink = text_ink(binary)
+    heights = []
+
+    for start, end in segment_lines(binary):
+        rows = ink[start:end].sum(axis=1)
+        peak = rows.max()
+
+        if peak <= 0:
+            continue
+
+        height = int((rows >= X_HEIGHT_INK_RATIO * peak).sum())
+
+        if height >= MINIMUM_LINE_HEIGHT // 2:
+            heights.append(height)
+
+    return sorted(heights)[len(heights) // 2] if heights else 0
+
+
+def fit_x_height(binary, target):
+    """Returns the (factor, dpi) that bring the text to target pixels."""
+    x_height = measure_x_height(binary) if target > 0 else 0
+
+    if x_height <= 0:
+        return 1.0, DEFAULT_DPI
+
+    factor = min(max(target / x_height, MINIMUM_SCALE), MAXIMUM_SCALE)
+
+    if abs(factor - 1.0) <= SCALE_TOLERANCE:
+        factor = 1.0
+
+    dpi = min(max(round(x_height * factor * DPI_PER_X_HEIGHT_PIXEL), MINIMUM_DPI), MAXIMUM_DPI)
+
+    return factor, dpi
+
+
+def rescale(binary, factor):
+    if factor == 1.0:
+        return binary
+
+    interpolation = cv2.INTER_AREA if factor < 1.0 else cv2.INTER_LINEAR
+    scaled = cv2.resize(binary, None, fx=factor, fy=factor, interpolation=interpolation)
+    _, scaled = cv2.threshold(scaled, INK_LEVEL - 1, 255, cv2.THRESH_BINARY)
+
+    return scaled
+
+
+class Readers:
+    """One Tesseract instance per worker thread, like TesseractPool."""
+
+    def __init__(self, tessdata, threads, x_height=0):
+        self.tessdata = str(tessdata)
+        self.x_height = x_height
+        self.local = threading.local()
+        self.pool = ThreadPoolExecutor(threads)
+
+    def api(self):
+        if not hasattr(self.local, 'api'):
+            self.local.api = PyTessBaseAPI(path=self.tessdata, lang='eng', oem=OEM.LSTM_ONLY)
+
+        return self.local.api
+
+    def recognize(self, binary, mode, scale):
+        factor, dpi = scale
+        binary = np.ascontiguousarray(rescale(binary, factor))
+
+        api = self.api()
+        api.SetPageSegMode(mode)
+        api.SetVariable('user_defined_dpi', str(dpi))
+        api.SetImageBytes(binary.tobytes(), binary.shape[1], binary.shape[0], 1, binary.shape[1])
+
+        return api.GetUTF8Text()
+
+    def read_block(self, binary):
+        scale = fit_x_height(binary, self.x_height)
+        return self.pool.submit(self.recognize, binary, PSM.SINGLE_BLOCK, scale).result()
+
+    def read_lines(self, binary):
+        scale = fit_x_height(binary, self.x_height)
+
+        futures = [
+            self.pool.submit(self.recognize, binary[start:end], PSM.SINGLE_LINE, scale)
+            for start, end in segment_lines(binary)
+        ]
+
+        lines = [future.result().rstrip(' \n') for future in futures]
+
+        return ''.join(line + '\n' for line in lines if line)
+
+
+def normalize(text):
+    """Compares text line by line, ignoring blank lines and repeated spaces."""
+    return '\n'.join(' '.join(line.split()) for line in text.splitlines() if line.strip())
+
+
+def distance(a, b):
+    previous = list(range(len(b) + 1))
+
+    for i, x in enumerate(a, 1):
+        current = [i]
+
+        for j, y in enumerate(b, 1):
+            current.append(min(previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (x != y)))
+
+        previous = current
+
+    return previous[-1]
+
+
+def evaluate(read, images, expected, warmup):
+    for image in images[:warmup]:
+        read(image)
+
+    latencies = []
+    errors = 0
+    characters = 0
+
+    for image, reference in zip(images, expected):
+        start = time.perf_counter()
+        text = read(image)
+        latencies.append((time.perf_counter() - start) * 1000)
+
+        reference = normalize(reference)
+        errors += distance(reference, normalize(text))
+        characters += len(reference)
+
+    return {
+        'cer': errors / characters if characters else float('nan'),
+        'p50': percentile(latencies, 50),
+        'p99': percentile(latencies, 99),
+    }
+
+
+def recordings(directories, simulate):
+    """Yields (name, crops) for every recording, enlarged ones included."""
+    for directory in directories:
+        paths = screenshots(directory)
+
+        if not paths:
+            continue
+
+        crops = [load_screenshot(path) for path in paths]
+        truths = [path.with_suffix('.txt') for path in paths]
+        expected = [truth.read_text(encoding='utf-8') if truth.exists() else None for truth in truths]
+
+        yield directory.name, crops, expected
+
+        if simulate:
+            for name, factor in SIMULATED:
+                enlarged = [
+                    cv2.resize(crop, None, fx=factor, fy=factor, interpolation=cv2.INTER_CUBIC) for crop in crops
+                ]
+
+                yield f'{directory.name} as {name}', enlarged, expected
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--tessdata', required=True, type=Path, help='directory containing eng.traineddata')
+    parser.add_argument('--tooltips', required=True, type=Path, nargs='+', help='directories of cropped tooltips')
+    parser.add_argument('--threads', type=int, default=4, help='Tesseract instances, like the native pool')
+    parser.add_argument('--x-height', type=int, default=20, help='target x-height in pixels, like ocr_x_height')
+    parser.add_argument('--simulate', action='store_true', help='also enlarge the recordings to 1440p and 4K')
+    parser.add_argument('--warmup', type=int, default=3)
+    args = parser.parse_args()
+
+    native = Readers(args.tessdata, args.threads)
+    scaled = Readers(args.tessdata, args.threads, args.x_height)
+
+    found = False
+
+    for name, crops, expected in recordings(args.tooltips, args.simulate):
+        found = True
+
+        images = [preprocess(crop) for crop in crops]
+        labelled = sum(text is not None for text in expected)
+
+        expected = [
+            text if text is not None else native.read_block(image) for text, image in zip(expected, images)
+        ]
+
+        x_heights = [measure_x_height(image) for image in images]
+
+        results = [
+            ('single block', evaluate(native.read_block, images, expected, args.warmup)),
+            ('block scaled', evaluate(scaled.read_block, images, expected, args.warmup)),
+            ('lines', evaluate(native.read_lines, images, expected, args.warmup)),
+            ('lines scaled', evaluate(scaled.read_lines, images, expected, args.warmup)),
+        ]
+
+        baseline = results[0][1]['p50']
+
+        print(f'{name}: {len(images)} tooltips, {labelled} with expected text, {args.threads} Tesseract instances')
+        print(f'median x-height {percentile(x_heights, 50):.0f} px, scaled to {args.x_height} px\n')
+        print(f'{"mode":<16} {"cer":>7} {"p50 ms":>8} {"p99 ms":>8} {"speedup":>8}')
+
+        for mode, result in results:
+            print(
+                f'{mode:<16} {result["cer"]:>7.4f} {result["p50"]:>8.1f} {result["p99"]:>8.1f} '
+                f'{baseline / result["p50"]:>7.2f}x'
+            )
+
+        print()
+
+    if not found:
+        parser.error(f'No tooltips found in {", ".join(str(path) for path in args.tooltips)}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,94 @@
+"""Writes an INT8 (QDQ) copy of the tooltip detector.
+
+Activations are calibrated on recorded screenshots, preprocessed exactly like
+GrimVault does. Only convolutions and matrix multiplications are quantized so
+the box decoding at the end of the graph stays in full precision.
+
+    python tools/quantize.py --model best.onnx --screenshots recordings/
+
+The result is written next to the model as best.int8.onnx, which is the name
+the native module looks for.
+"""
+
+import argparse
+import tempfile
+from pathlib import Path
+
+from onnxruntime.quantization import (
+    CalibrationDataReader,
+    CalibrationMethod,
+    QuantFormat,
+    QuantType,
+    quantize_static,
+)
+from onnxruntime.quantization.shape_inference import quant_pre_process
+
+from detector import Detector, letterbox, load_screenshot, screenshots
+
+
+class ScreenshotReader(CalibrationDataReader):
+    def __init__(self, paths, input_name, width, height):
+        self.paths = iter(paths)
+        self.input_name = input_name
+        self.width = width
+        self.height = height
+
+    def get_next(self):
+        path = next(self.paths, None)
+
+        if path is None:
+            return None
+
+        blob, _ = letterbox(load_screenshot(path), self.width, self.height)
+
+        return {self.input_name: blob}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--model', required=True, type=Path, help='FP32 ONNX export of the detector')
+    parser.add_argument('--screenshots', required=True, type=Path, help='directory of recorded screenshots')
+    parser.add_argument('--output', type=Path, help='defaults to <model>.int8.onnx')
+    parser.add_argument('--limit', type=int, default=200, help='maximum number of calibration screenshots')
+    parser.add_argument('--method', choices=['minmax', 'entropy', 'percentile'], default='percentile')
+    args = parser.parse_args()
+
+    output = args.output or args.model.with_suffix('.int8.onnx')
+    paths = screenshots(args.screenshots)[:args.limit]
+
+    if not paths:
+        parser.error(f'No screenshots found in {args.screenshots}')
+
+    detector = Detector(args.model)
+
+    methods = {
+        'minmax': CalibrationMethod.MinMax,
+        'entropy': CalibrationMethod.Entropy,
+        'percentile': CalibrationMethod.Percentile,
+    }
+
+    with tempfile.TemporaryDirectory() as scratch:
+        prepared = Path(scratch) / 'prepared.onnx'
+
+        # Folds constants and infers shapes, which quantization relies on.
+        quant_pre_process(str(args.model), str(prepared))
+
+        print(f'Calibrating on {len(paths)} screenshots')
+
+        quantize_static(
+            model_input=str(prepared),
+            model_output=str(output),
+            calibration_data_reader=ScreenshotReader(paths, detector.input.name, detector.width, detector.height),
+            quant_format=QuantFormat.QDQ,
+            activation_type=QuantType.QUInt8,
+            weight_type=QuantType.QInt8,
+            per_channel=True,
+            op_types_to_quantize=['Conv', 'MatMul'],
+            calibrate_method=methods[args.method],
+        )
+
+    print(f'Wrote {output}')
+
+
+if __name__ == '__main__':
+    main()
\ No newline at end of file
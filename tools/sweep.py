@@ -0,0 +1,93 @@
+"""Sweeps the input size of the tooltip detector for recall and latency.
+
+The reference model at 640x640 provides the ground truth, every size is then
+evaluated on the same screenshots. A size is run from its own export when one
+exists next to the model (best-320.onnx, best-416.int8.onnx, ...), otherwise
+from the model itself, which needs an export with dynamic axes.
+
+    python tools/sweep.py --model best.onnx --screenshots recordings/
+
+The smallest size whose recall stays above --minimum-recall is the one to put
+into detector_input_size in settings.ini.
+"""
+
+import argparse
+from pathlib import Path
+
+from detector import Detector, load_screenshot, screenshots
+from evaluate import evaluate
+
+SIZES = [640, 512, 416, 320]
+REFERENCE_SIZE = 640
+
+
+def export_for(model, size, quantized):
+    """Returns the export GrimVault would load for a size, like Screen::ModelCandidates."""
+    sized = model.with_name(f'{model.stem}-{size}.onnx')
+    candidates = [sized, model] if size != REFERENCE_SIZE else [model]
+
+    if quantized:
+        candidates = [path for candidate in candidates for path in (candidate.with_suffix('.int8.onnx'), candidate)]
+
+    return next((path for path in candidates if path.exists()), None)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--model', required=True, type=Path, help='FP32 ONNX export of the detector')
+    parser.add_argument('--screenshots', required=True, type=Path, help='directory of recorded screenshots')
+    parser.add_argument('--sizes', type=int, nargs='+', default=SIZES)
+    parser.add_argument('--quantized', action='store_true', help='prefer INT8 exports like GrimVault does')
+    parser.add_argument('--minimum-recall', type=float, default=0.99)
+    parser.add_argument('--threads', type=int, default=0, help='intra-op threads, 0 lets ONNX Runtime decide')
+    parser.add_argument('--warmup', type=int, default=3)
+    args = parser.parse_args()
+
+    paths = screenshots(args.screenshots)
+
+    if not paths:
+        parser.error(f'No screenshots found in {args.screenshots}')
+
+    images = [load_screenshot(path) for path in paths]
+
+    reference = Detector(args.model, args.threads, REFERENCE_SIZE)
+    truth = [reference.detect(image)[0] for image in images]
+
+    results = []
+
+    for size in sorted(args.sizes, reverse=True):
+        model = export_for(args.model, size, args.quantized)
+
+        try:
+            detector = Detector(model, args.threads, size)
+        except ValueError as error:
+            print(f'Skipping {size}: {error}')
+            continue
+
+        results.append((size, model, evaluate(detector, images, truth, args.warmup)))
+
+    if not results:
+        parser.error('No export could run at any of the requested sizes')
+
+    print(f'{len(images)} screenshots, {sum(len(boxes) for boxes in truth)} reference tooltips\n')
+    print(f'{"size":>5} {"model":<32} {"recall":>7} {"iou":>6} {"extra":>6} {"p50 ms":>8} {"p99 ms":>8}')
+
+    for size, model, result in results:
+        print(
+            f'{size:>5} {model.name:<32} {result["recall"]:>7.3f} {result["iou"]:>6.3f} {result["extra"]:>6} '
+            f'{result["p50"]:>8.1f} {result["p99"]:>8.1f}'
+        )
+
+    accepted = [
+        (result['p50'], size) for size, _, result in results
+        if result['recall'] >= args.minimum_recall
+    ]
+
+    if accepted:
+        print(f'\nCheapest size with recall >= {args.minimum_recall}: {min(accepted)[1]}')
+    else:
+        print(f'\nNo size reaches a recall of {args.minimum_recall}')
+
+
+if __name__ == '__main__':
+    main()
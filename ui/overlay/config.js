@@ -2,8 +2,13 @@ const MOUSE_STILL_FOR_MS = 150;
 const MOUSE_WAKEUP_DISTANCE = 15;
 const EDGE_PADDING = 5;
 
+// How far from the cursor, relative to the game height, tooltips are looked
+// for before falling back to scanning the whole screen.
+const SCAN_RADIUS_RATIO = 0.35;
+
 export {
   MOUSE_STILL_FOR_MS,
   MOUSE_WAKEUP_DISTANCE,
-  EDGE_PADDING
+  EDGE_PADDING,
+  SCAN_RADIUS_RATIO
 }
\ No newline at end of file
@@ -38,9 +38,9 @@ export function onMouseStill (callback, stillForMs = 100) {
   function onCheckStill () {
     const now = Date.now ();
 
-    // If enough time has passed without movement
+    // If enough time has passed without movement, tell since when
     if (lastMoveTime && now - lastMoveTime >= stillForMs) {
-      callback ();
+      callback (lastMoveTime);
 
       sleepPosition = lastPosition;
 
@@ -81,6 +81,10 @@ export function onMouseWakeup (callback, minDistance = 5) {
   window.addEventListener ('mousemove', onMouseMove);
 }
 
+export function getMousePosition () {
+  return currentPosition;
+}
+
 export function setMouseSleepPosition (position) {
   if (!position) {
     position = currentPosition;
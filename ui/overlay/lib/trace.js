@@ -0,0 +1,18 @@
+// Steps of a scan in the overlay. They are sent to the main process, which
+// traces them next to its own and the native ones under the scan's
+// correlation ID.
+
+let latestScan = 0;
+
+// Epoch milliseconds, which line up with the main process.
+export function now () {
+  return performance.timeOrigin + performance.now ();
+}
+
+export function nextScan () {
+  return ++latestScan;
+}
+
+export function span (name, scan, start, end = now ()) {
+  electron.send ('trace', { name, scan, start, end });
+}
\ No newline at end of file